@@ -23,10 +23,17 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+//For SEEK_DATA and SEEK_HOLE
+#define _GNU_SOURCE
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -34,7 +41,10 @@
 #include <errno.h>
 #include <signal.h>
 #include <termios.h>
+#include <poll.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <setjmp.h>
 
 static int reverse_byte = 0;
 static int fd = -1;
@@ -46,10 +56,60 @@ static off_t buffer_offset = -1;
 static size_t buffer_width = 0;
 static int last_term_w = 0;
 static int last_term_h = 0;
+static volatile sig_atomic_t term_resized = 1;
+static int term_cols = 0;
+static int term_rows = 0;
 static int col_offset = 0;
 static int delay_ms = 250;
+static int life_rate = -1;
+static int frame_rate = 30;
 static int life = 0;
 static uint8_t* life_buffer = 0;
+static uint8_t* life_state = 0;
+//A padded row standing in below the last whole row of a wrapped world
+//that ends in a partial row, which is kept out of the wrap
+static uint8_t* life_wrap = 0;
+static size_t life_stride = 0;
+static size_t life_grid_size = 0;
+static off_t life_origin = 0;
+static size_t life_size = 0;
+static uint32_t life_birth = 1<<3;
+static uint32_t life_survive = 1<<2 | 1<<3;
+static int life_topology = 0;
+static uint64_t life_generation = 0;
+static uint64_t life_population = 0;
+static uint64_t life_births = 0;
+static uint64_t life_deaths = 0;
+static uint64_t life_period = 0;
+static int wolfram_rule = 30;
+static uint8_t* wolfram_ring = 0;
+static size_t wolfram_stride = 0;
+static size_t wolfram_rows = 0;
+static uint64_t wolfram_generation = 0;
+static uint8_t* file_map = 0;
+static int file_map_advice = MADV_NORMAL;
+static off_t predict_offset = -1;
+static off_t predict_delta = 0;
+static uint8_t* read_buffer = 0;
+static size_t read_buffer_size = 0;
+static size_t read_lo = 0;
+static size_t read_hi = 0;
+static char* out_buffer = 0;
+static size_t out_size = 0;
+static size_t out_len = 0;
+static uint8_t* frame = 0;
+static uint8_t* last_frame = 0;
+static uint8_t* frame_dirty = 0;
+static int frame_w = 0;
+static int frame_h = 0;
+static int frame_valid = 0;
+static off_t frame_offset = 0;
+static int frame_col_offset = 0;
+static int frame_zoom = 0;
+static int zoom_shift = 0;
+static int zoom_mode = 0;
+static int zoom_threshold = 25;
+static int view_zoom = 0;
 
 #define UTF8_IMPLEMENTATION
 #include "utf8.h"
@@ -76,14 +136,52 @@ static void usage(char* cmd) {
 		}
 	}
 	fprintf(stderr,"Usage:\n");
-	fprintf(stderr,"%s [-h] [-r] [-wWidth] [-oOffset] [-dDelayMS] [path]\n",cmd_filename);
+	fprintf(stderr,"%s [-h] [-r] [-wWidth] [-oOffset] [-dDelayMS] [-GGens] [-FFrames] [-RRule] [-TTopology] [-ERule] [-gGlyphs] [-PPercent] [path]\n",cmd_filename);
 	fprintf(stderr,"\n");
 	fprintf(stderr,"  -w : Bit width of buffer (controls horizontal scroll)\n");
 	fprintf(stderr,"       Width must be a multple of 8 bits.\n");
 	fprintf(stderr,"  -o : Initial Byte offset into file\n");
 	fprintf(stderr,"  -d : Delay, in millisecons, or any automatic updates\n");
+	fprintf(stderr,"  -G : Run Life on a thread of its own at this many generations a second,\n");
+	fprintf(stderr,"       or as fast as it can for 0, instead of one every -d\n");
+	fprintf(stderr,"  -F : Frames a second to draw while Life runs with -G (default 30)\n");
+	fprintf(stderr,"  -R : Life rule, as B3/S23 (the default) or 23/3\n");
+	fprintf(stderr,"  -T : Life topology: plane (the default), torus or klein\n");
+	fprintf(stderr,"       (the waterfall's rows wrap round for torus and klein)\n");
+	fprintf(stderr,"  -E : Elementary cellular automaton rule (0-255) for the waterfall (default 30)\n");
+	fprintf(stderr,"  -g : Pixels drawn by each character: sextant (2x3, the default), braille (2x4),\n");
+	fprintf(stderr,"       octant (2x4), quadrant (2x2) or half (1x2)\n");
+	fprintf(stderr,"  -P : Share of a zoomed out pixel's bits that must be set in density mode\n");
+	fprintf(stderr,"       (percent, default 25)\n");
 	fprintf(stderr,"\n");
 	fprintf(stderr,"If path is not provided, data is streamed from stdin; -o is ignored\n");
+	fprintf(stderr,"\n");
+	fprintf(stderr,"Keys:\n");
+	fprintf(stderr,"  Left/Right h/l : Scroll by one bit\n");
+	fprintf(stderr,"  Up/Down k/j    : Scroll by one row of bits\n");
+	fprintf(stderr,"  K/J            : Scroll by one row of text (one character of bits)\n");
+	fprintf(stderr,"  PgUp/PgDn      : Scroll by one screen\n");
+	fprintf(stderr,"  Home/End       : Jump to the start/end of the file\n");
+	fprintf(stderr,"  n/p            : Jump to the next/previous data, skipping holes\n");
+	fprintf(stderr,"  m              : Show a map of data (#) and holes (.) on the bottom row\n");
+	fprintf(stderr,"  M              : Show a minimap of the file's bit density down the right,\n");
+	fprintf(stderr,"                   built in the background (the view is in reverse video)\n");
+	fprintf(stderr,"  0-9            : Jump to that tenth of the file\n");
+	fprintf(stderr,"  [/]            : Jump to the previous/next row of the minimap\n");
+	fprintf(stderr,"  -/+            : Zoom out/in: each pixel stands for 2^k bits of the file\n");
+	fprintf(stderr,"  a              : Set zoomed out pixels for any, a majority or a density (-P)\n");
+	fprintf(stderr,"                   of set bits\n");
+	fprintf(stderr,"  i              : Show offsets\n");
+	fprintf(stderr,"  r              : Run the Game of Life (or -R rule) over the whole file\n");
+	fprintf(stderr,"                   until it repeats; again to pause or carry on\n");
+	fprintf(stderr,"  g              : Jump Life ahead 2^k generations (HashLife); a world over\n");
+	fprintf(stderr,"                   32 KiB is cut down to the rows in view first\n");
+	fprintf(stderr,"  x              : Drop Life's world and show the file again\n");
+	fprintf(stderr,"  t              : Time the Life kernels on the world and use the fastest\n");
+	fprintf(stderr,"                   (done when the world is made; the status row shows the pick)\n");
+	fprintf(stderr,"  e              : Start/stop a waterfall of rule -E generations from the top row\n");
+	fprintf(stderr,"  </>            : Halve/double the jump (k-1/k+1, default 2^10)\n");
+	fprintf(stderr,"  q/Esc          : Quit\n");
 	exit(0);
 }
 
@@ -150,310 +248,4414 @@ static void term_reset() {
 static void term_size(int* width, int* height) {
 	struct winsize ws;
 	
-	//Use ioctl/TIOCGWINSZ to get terminal size
-	errno = 0;
-	if( ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws) < 0 ) {
-		ERROR("Error geting terminal size: %s\n",strerror(errno));
+	//Use ioctl/TIOCGWINSZ to get terminal size, but only again once a
+	//SIGWINCH has set term_resized
+	if( term_resized ) {
+		term_resized = 0;
+		errno = 0;
+		if( ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws) < 0 ) {
+			ERROR("Error geting terminal size: %s\n",strerror(errno));
+		}
+		term_cols = ws.ws_col;
+		term_rows = ws.ws_row;
+	}
+	*width = term_cols;
+	*height = term_rows;
+}
+
+static uint32_t sextant_chars[64] = {
+	0x00020,0x1FB1E,0x1FB0F,0x1FB2D,0x1FB07,0x1FB26,0x1FB16,0x1FB35,
+	0x1FB03,0x1FB22,0x1FB13,0x1FB31,0x1FB0B,0x1FB29,0x1FB1A,0x1FB39,
+	0x1FB01,0x1FB20,0x1FB11,0x1FB2F,0x1FB09,0x02590,0x1FB18,0x1FB37,
+	0x1FB05,0x1FB24,0x1FB14,0x1FB33,0x1FB0D,0x1FB2B,0x1FB1C,0x1FB3B,
+	0x1FB00,0x1FB1F,0x1FB10,0x1FB2E,0x1FB08,0x1FB27,0x1FB17,0x1FB36,
+	0x1FB04,0x1FB23,0x0258C,0x1FB32,0x1FB0C,0x1FB2A,0x1FB1B,0x1FB3A,
+	0x1FB02,0x1FB21,0x1FB12,0x1FB30,0x1FB0A,0x1FB28,0x1FB19,0x1FB38,
+	0x1FB06,0x1FB25,0x1FB15,0x1FB34,0x1FB0E,0x1FB2C,0x1FB1D,0x02588
+};
+
+//Octant masks (bit n-1 for octant n, numbered left to right, top to
+//bottom) that Unicode 16 leaves out of the octant block because an
+//older block or quadrant character already draws them.  The other 230
+//masks follow in order from U+1CD00.
+static const struct {
+	uint8_t mask;
+	uint32_t c;
+} octant_older[] = {
+	{0x00,0x00020},{0x01,0x1CEA8},{0x02,0x1CEAB},{0x03,0x1FB82},
+	{0x05,0x02598},{0x0A,0x0259D},{0x0F,0x02580},{0x14,0x1FBE6},
+	{0x28,0x1FBE7},{0x3F,0x1FB85},{0x40,0x1CEA3},{0x50,0x02596},
+	{0x55,0x0258C},{0x5A,0x0259E},{0x5F,0x0259B},{0x80,0x1CEA0},
+	{0xA0,0x02597},{0xA5,0x0259A},{0xAA,0x02590},{0xAF,0x0259C},
+	{0xC0,0x02582},{0xF0,0x02584},{0xF5,0x02599},{0xFA,0x0259F},
+	{0xFC,0x02586},{0xFF,0x02588}
+};
+
+static uint32_t quadrant_chars[16] = {
+	0x00020,0x02597,0x02596,0x02584,0x0259D,0x02590,0x0259E,0x0259F,
+	0x02598,0x0259A,0x0258C,0x02599,0x02580,0x0259C,0x0259B,0x02588
+};
+
+static uint32_t half_chars[4] = {0x00020,0x02584,0x02580,0x02588};
+
+//What each character cell draws, picked with -g.  A cell is glyph_w by
+//glyph_h pixels.
+#define GLYPH_SEXTANT 0
+#define GLYPH_BRAILLE 1
+#define GLYPH_OCTANT 2
+#define GLYPH_QUADRANT 3
+#define GLYPH_HALF 4
+static const char* glyph_names[] = {"sextant","braille","octant","quadrant","half"};
+static int glyph_mode = GLYPH_SEXTANT;
+static int glyph_w = 2;
+static int glyph_h = 3;
+
+//UTF-8 encoded characters for every glyph index of the mode, built once
+//by glyph_setup().  Each entry is padded to 4 Bytes so it can be copied
+//without looking at the length.
+static char glyph_utf8[256][4];
+static uint8_t glyph_utf8_len[256];
+
+static inline uint64_t load_le64(const uint8_t* src) {
+	uint64_t v;
+	
+	memcpy(&v,src,8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+//Reverse the bit order within each Byte of a word
+static inline uint64_t reverse_bits(uint64_t v) {
+	v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+	v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+	v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	return v;
+}
+
+//Read the 64 pixels starting at pixel x of a row that has len valid
+//Bytes (pixels past the end read as 0), pixel i in bit i
+static inline uint64_t row_bits(const uint8_t* row, size_t len, size_t x) {
+	size_t byte = x/8;
+	int shift = x%8;
+	uint64_t lo, hi;
+	uint8_t tail[9];
+	
+	if( byte+9 <= len ) {
+		lo = load_le64(row+byte);
+		hi = row[byte+8];
+	}
+	else {
+		memset(tail,0,sizeof(tail));
+		if( byte < len ) {
+			memcpy(tail,row+byte,len-byte);
+		}
+		lo = load_le64(tail);
+		hi = tail[8];
+	}
+	//Put pixel p of each Byte in bit p
+	if( !reverse_byte ) {
+		lo = reverse_bits(lo);
+		hi = reverse_bits(hi);
+	}
+	if( shift ) {
+		lo = (lo >> shift) | (hi << (64-shift));
+	}
+	return lo;
+}
+
+//The same 64 pixels as 32 pixel pairs: the pair for cell i is in bits
+//2i+1 (left) and 2i (right)
+static inline uint64_t row_pairs(const uint8_t* row, size_t len, size_t x) {
+	uint64_t v = row_bits(row,len,x);
+	
+	//Swap each pixel pair so the left pixel is the high bit
+	return ((v & 0x5555555555555555ULL) << 1) | ((v >> 1) & 0x5555555555555555ULL);
+}
+
+//Turn words of pixel pairs (see row_pairs()) from the three rows of a
+//text row into sextant indices, 32 per word
+typedef void (*sextant_expand_fn)(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words);
+
+static void sextant_expand_word(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words) {
+	size_t w;
+	int i, s;
+	
+	for( w=0; w<words; w++ ) {
+		for( i=0; i<32; i++ ) {
+			s = 2*i;
+			out[i] = (((a[w]>>s)&3)<<4) | (((b[w]>>s)&3)<<2) | ((c[w]>>s)&3);
+		}
+		out += 32;
+	}
+}
+
+//The other glyph modes take the words of their h rows of pixels (pairs
+//from row_pairs(), or single pixels from row_bits() for half blocks)
+//and turn them into glyph indices.  Row r of a cell lands in the bits
+//of the index just above those of row r+1, left pixel high.
+typedef void (*glyph_expand_fn)(uint8_t* out, const uint64_t* const* p, size_t words);
+
+//2x4 cells (braille and octants), 32 per word
+static void octant_expand_word(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int i, s;
+	
+	for( w=0; w<words; w++ ) {
+		for( i=0; i<32; i++ ) {
+			s = 2*i;
+			out[i] = (((p[0][w]>>s)&3)<<6) | (((p[1][w]>>s)&3)<<4) | (((p[2][w]>>s)&3)<<2) | ((p[3][w]>>s)&3);
+		}
+		out += 32;
+	}
+}
+
+//2x2 cells (quadrants), 32 per word
+static void quadrant_expand_word(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int i, s;
+	
+	for( w=0; w<words; w++ ) {
+		for( i=0; i<32; i++ ) {
+			s = 2*i;
+			out[i] = (((p[0][w]>>s)&3)<<2) | ((p[1][w]>>s)&3);
+		}
+		out += 32;
+	}
+}
+
+//1x2 cells (half blocks), 64 per word
+static void half_expand_word(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int i;
+	
+	for( w=0; w<words; w++ ) {
+		for( i=0; i<64; i++ ) {
+			out[i] = (((p[0][w]>>i)&1)<<1) | ((p[1][w]>>i)&1);
+		}
+		out += 64;
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+
+//Deposit each 16 bit slice of the pair words into 8 output Bytes
+__attribute__((target("bmi2")))
+static void sextant_expand_bmi2(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words) {
+	size_t w;
+	int k;
+	uint64_t v;
+	
+	for( w=0; w<words; w++ ) {
+		for( k=0; k<64; k+=16 ) {
+			v = _pdep_u64((a[w]>>k)&0xFFFF,0x3030303030303030ULL) |
+			    _pdep_u64((b[w]>>k)&0xFFFF,0x0C0C0C0C0C0C0C0CULL) |
+			    _pdep_u64((c[w]>>k)&0xFFFF,0x0303030303030303ULL);
+			memcpy(out,&v,8);
+			out += 8;
+		}
+	}
+}
+
+__attribute__((target("bmi2")))
+static void octant_expand_bmi2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int k;
+	uint64_t v;
+	
+	for( w=0; w<words; w++ ) {
+		for( k=0; k<64; k+=16 ) {
+			v = _pdep_u64((p[0][w]>>k)&0xFFFF,0xC0C0C0C0C0C0C0C0ULL) |
+			    _pdep_u64((p[1][w]>>k)&0xFFFF,0x3030303030303030ULL) |
+			    _pdep_u64((p[2][w]>>k)&0xFFFF,0x0C0C0C0C0C0C0C0CULL) |
+			    _pdep_u64((p[3][w]>>k)&0xFFFF,0x0303030303030303ULL);
+			memcpy(out,&v,8);
+			out += 8;
+		}
+	}
+}
+
+__attribute__((target("bmi2")))
+static void quadrant_expand_bmi2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int k;
+	uint64_t v;
+	
+	for( w=0; w<words; w++ ) {
+		for( k=0; k<64; k+=16 ) {
+			v = _pdep_u64((p[0][w]>>k)&0xFFFF,0x0C0C0C0C0C0C0C0CULL) |
+			    _pdep_u64((p[1][w]>>k)&0xFFFF,0x0303030303030303ULL);
+			memcpy(out,&v,8);
+			out += 8;
+		}
+	}
+}
+
+__attribute__((target("bmi2")))
+static void half_expand_bmi2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int k;
+	uint64_t v;
+	
+	for( w=0; w<words; w++ ) {
+		for( k=0; k<64; k+=8 ) {
+			v = _pdep_u64((p[0][w]>>k)&0xFF,0x0202020202020202ULL) |
+			    _pdep_u64((p[1][w]>>k)&0xFF,0x0101010101010101ULL);
+			memcpy(out,&v,8);
+			out += 8;
+		}
+	}
+}
+
+//Byte j of each 32 bit lane holds a copy of the same pair Byte.  Move
+//pair j down to bits 0-1 of Byte j.
+__attribute__((target("sse2")))
+static inline __m128i sextant_select_sse2(__m128i v) {
+	return _mm_or_si128(
+		_mm_or_si128(_mm_and_si128(v,_mm_set1_epi32(0x00000003)),
+		             _mm_and_si128(_mm_srli_epi16(v,2),_mm_set1_epi32(0x00000300))),
+		_mm_or_si128(_mm_and_si128(_mm_srli_epi16(v,4),_mm_set1_epi32(0x00030000)),
+		             _mm_and_si128(_mm_srli_epi16(v,6),_mm_set1_epi32(0x03000000))));
+}
+
+__attribute__((target("sse2")))
+static void sextant_expand_sse2(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words) {
+	__m128i v[3], t[3], r[3];
+	int i, j;
+	
+	for( ; words>=2; words-=2 ) {
+		v[0] = _mm_loadu_si128((const __m128i*)a);
+		v[1] = _mm_loadu_si128((const __m128i*)b);
+		v[2] = _mm_loadu_si128((const __m128i*)c);
+		for( j=0; j<4; j++ ) {
+			//Replicate each pair Byte four times, 16 cells at a time
+			for( i=0; i<3; i++ ) {
+				t[i] = j < 2 ? _mm_unpacklo_epi8(v[i],v[i]) : _mm_unpackhi_epi8(v[i],v[i]);
+				r[i] = j & 1 ? _mm_unpackhi_epi16(t[i],t[i]) : _mm_unpacklo_epi16(t[i],t[i]);
+				r[i] = sextant_select_sse2(r[i]);
+			}
+			_mm_storeu_si128((__m128i*)out,_mm_or_si128(
+				_mm_or_si128(_mm_slli_epi16(r[0],4),_mm_slli_epi16(r[1],2)),r[2]));
+			out += 16;
+		}
+		a += 2;
+		b += 2;
+		c += 2;
+	}
+	sextant_expand_word(out,a,b,c,words);
+}
+
+//Replicate each Byte of a pair word into 4 Bytes, then keep pair j in
+//Byte j and map it down with a nibble lookup (pre-shifted by shift)
+__attribute__((target("avx2")))
+static inline __m256i sextant_pairs_avx2(uint64_t w, __m256i lut) {
+	const __m256i spread = _mm256_setr_epi8(
+		0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,
+		4,4,4,4,5,5,5,5,6,6,6,6,7,7,7,7);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i v;
+	
+	v = _mm256_shuffle_epi8(_mm256_set1_epi64x(w),spread);
+	v = _mm256_and_si256(v,_mm256_set1_epi32(0xC0300C03));
+	return _mm256_or_si256(
+		_mm256_shuffle_epi8(lut,_mm256_and_si256(v,nibble)),
+		_mm256_shuffle_epi8(lut,_mm256_and_si256(_mm256_srli_epi16(v,4),nibble)));
+}
+
+__attribute__((target("avx2")))
+static void sextant_expand_avx2(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words) {
+	//Low and high nibble of a masked Byte hold either a pair (0-3) or a
+	//pair shifted up by 2 (0,4,8,12)
+	const __m256i lut_a = _mm256_setr_epi8(
+		0x00,0x10,0x20,0x30,0x10,0,0,0,0x20,0,0,0,0x30,0,0,0,
+		0x00,0x10,0x20,0x30,0x10,0,0,0,0x20,0,0,0,0x30,0,0,0);
+	const __m256i lut_b = _mm256_srli_epi16(lut_a,2);
+	const __m256i lut_c = _mm256_srli_epi16(lut_a,4);
+	size_t w;
+	
+	for( w=0; w<words; w++ ) {
+		_mm256_storeu_si256((__m256i*)out,_mm256_or_si256(
+			_mm256_or_si256(sextant_pairs_avx2(a[w],lut_a),sextant_pairs_avx2(b[w],lut_b)),
+			sextant_pairs_avx2(c[w],lut_c)));
+		out += 32;
+	}
+}
+
+//The sextant lookup moved up or down a row of the cell
+__attribute__((target("avx2")))
+static void octant_expand_avx2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	const __m256i lut_b = _mm256_setr_epi8(
+		0x00,0x10,0x20,0x30,0x10,0,0,0,0x20,0,0,0,0x30,0,0,0,
+		0x00,0x10,0x20,0x30,0x10,0,0,0,0x20,0,0,0,0x30,0,0,0);
+	const __m256i lut_a = _mm256_slli_epi16(lut_b,2);
+	const __m256i lut_c = _mm256_srli_epi16(lut_b,2);
+	const __m256i lut_d = _mm256_srli_epi16(lut_b,4);
+	size_t w;
+	
+	for( w=0; w<words; w++ ) {
+		_mm256_storeu_si256((__m256i*)out,_mm256_or_si256(
+			_mm256_or_si256(sextant_pairs_avx2(p[0][w],lut_a),sextant_pairs_avx2(p[1][w],lut_b)),
+			_mm256_or_si256(sextant_pairs_avx2(p[2][w],lut_c),sextant_pairs_avx2(p[3][w],lut_d))));
+		out += 32;
+	}
+}
+
+__attribute__((target("avx2")))
+static void quadrant_expand_avx2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	const __m256i lut_b = _mm256_setr_epi8(
+		0x00,0x04,0x08,0x0C,0x04,0,0,0,0x08,0,0,0,0x0C,0,0,0,
+		0x00,0x04,0x08,0x0C,0x04,0,0,0,0x08,0,0,0,0x0C,0,0,0);
+	const __m256i lut_c = _mm256_srli_epi16(lut_b,2);
+	size_t w;
+	
+	for( w=0; w<words; w++ ) {
+		_mm256_storeu_si256((__m256i*)out,_mm256_or_si256(
+			sextant_pairs_avx2(p[0][w],lut_b),sextant_pairs_avx2(p[1][w],lut_c)));
+		out += 32;
+	}
+}
+
+//Spread 32 pixels to a Byte each: copy pixel Byte j to Bytes 8j to
+//8j+7, keep one bit in each and widen it to the whole Byte
+__attribute__((target("avx2")))
+static inline __m256i half_bits_avx2(uint32_t v) {
+	const __m256i spread = _mm256_setr_epi8(
+		0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+		2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+	const __m256i bit = _mm256_set1_epi64x(0x8040201008040201ULL);
+	__m256i x;
+	
+	x = _mm256_shuffle_epi8(_mm256_set1_epi32(v),spread);
+	return _mm256_cmpeq_epi8(_mm256_and_si256(x,bit),bit);
+}
+
+__attribute__((target("avx2")))
+static void half_expand_avx2(uint8_t* out, const uint64_t* const* p, size_t words) {
+	size_t w;
+	int k;
+	
+	for( w=0; w<words; w++ ) {
+		for( k=0; k<64; k+=32 ) {
+			_mm256_storeu_si256((__m256i*)out,_mm256_or_si256(
+				_mm256_and_si256(half_bits_avx2(p[0][w]>>k),_mm256_set1_epi8(2)),
+				_mm256_and_si256(half_bits_avx2(p[1][w]>>k),_mm256_set1_epi8(1))));
+			out += 32;
+		}
+	}
+}
+
+//Gather the 16 bits for 8 cells into each 64 bit lane and pull every
+//pair out to its final position with a multishift
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void sextant_expand_avx512(uint8_t* out, const uint64_t* a, const uint64_t* b, const uint64_t* c, size_t words) {
+	const __m512i gather = _mm512_set_epi64(
+		0x0F0E0F0E0F0E0F0EULL,0x0D0C0D0C0D0C0D0CULL,0x0B0A0B0A0B0A0B0AULL,0x0908090809080908ULL,
+		0x0706070607060706ULL,0x0504050405040504ULL,0x0302030203020302ULL,0x0100010001000100ULL);
+	//Bit offsets 2i, 2i-2 and 2i-4 (modulo 64) for output Byte i
+	const __m512i shift_c = _mm512_set1_epi64(0x0E0C0A0806040200ULL);
+	const __m512i shift_b = _mm512_set1_epi64(0x0C0A08060402003EULL);
+	const __m512i shift_a = _mm512_set1_epi64(0x0A08060402003E3CULL);
+	const __m512i mask_a = _mm512_set1_epi8(0x30);
+	const __m512i mask_c = _mm512_set1_epi8(0x03);
+	const __m512i mask = _mm512_set1_epi8(0x3F);
+	__m512i va, vb, vc, v;
+	
+	for( ; words>=2; words-=2 ) {
+		va = _mm512_permutexvar_epi8(gather,_mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)a)));
+		vb = _mm512_permutexvar_epi8(gather,_mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)b)));
+		vc = _mm512_permutexvar_epi8(gather,_mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)c)));
+		va = _mm512_multishift_epi64_epi8(shift_a,va);
+		vb = _mm512_multishift_epi64_epi8(shift_b,vb);
+		vc = _mm512_multishift_epi64_epi8(shift_c,vc);
+		//Bits 4-5 from a, 0-1 from c, the rest from b
+		v = _mm512_ternarylogic_epi64(mask_a,va,vb,0xCA);
+		v = _mm512_ternarylogic_epi64(mask_c,vc,v,0xCA);
+		_mm512_storeu_si512(out,_mm512_and_si512(v,mask));
+		out += 64;
+		a += 2;
+		b += 2;
+		c += 2;
+	}
+	sextant_expand_avx2(out,a,b,c,words);
+}
+#endif //SIMD_X86
+
+//Life grids are padded so the kernels can load a vector either side
+//of any cell without bounds checks: LIFE_PAD zero Bytes before each
+//row, the row rounded up to LIFE_ROW_ALIGN Bytes (the widest vector),
+//LIFE_PAD zero Bytes after it, and a zero row above the first row and
+//below the last.
+#define LIFE_PAD 8
+#define LIFE_ROW_ALIGN 64
+#define LIFE_CONWAY_BIRTH (1<<3)
+#define LIFE_CONWAY_SURVIVE (1<<2 | 1<<3)
+#define LIFE_PLANE 0
+#define LIFE_TORUS 1
+#define LIFE_KLEIN 2
+#define LIFE_TILE_ROWS 64
+#define LIFE_TILE_BYTES 64
+
+static inline uint8_t* life_row(uint8_t* grid, size_t y) {
+	return grid + (y+1)*life_stride + LIFE_PAD;
+}
+
+//Generation y of the waterfall, padded like a row of Life's grid.  The
+//ring keeps each generation twice, wolfram_rows apart, so the rows of
+//any view of it run on without wrapping.
+static inline uint8_t* wolfram_row(uint64_t y) {
+	return wolfram_ring + (y % wolfram_rows)*wolfram_stride + LIFE_PAD;
+}
+
+static inline uint64_t life_load(const uint8_t* src) {
+	uint64_t v;
+	
+	memcpy(&v,src,8);
+	return v;
+}
+
+//The cells west and east of each cell of the word at src.  Every
+//operation stays within its Byte lane (the neighbouring Byte's edge
+//bit comes from the word loaded a Byte earlier or later), so this
+//works for either byte order in memory.
+static inline uint64_t life_west(const uint8_t* src, uint64_t v, const int reverse) {
+	if( reverse ) {
+		return ((v << 1) & 0xFEFEFEFEFEFEFEFEull) | ((life_load(src-1) >> 7) & 0x0101010101010101ull);
+	}
+	return ((v >> 1) & 0x7F7F7F7F7F7F7F7Full) | ((life_load(src-1) << 7) & 0x8080808080808080ull);
+}
+
+static inline uint64_t life_east(const uint8_t* src, uint64_t v, const int reverse) {
+	if( reverse ) {
+		return ((v >> 1) & 0x7F7F7F7F7F7F7F7Full) | ((life_load(src+1) << 7) & 0x8080808080808080ull);
+	}
+	return ((v << 1) & 0xFEFEFEFEFEFEFEFEull) | ((life_load(src+1) >> 7) & 0x0101010101010101ull);
+}
+
+//Cells c next generation, given their neighbour counts in bits s0 to
+//s3, for the rule with bit n of birth (survive) set if a dead (live)
+//cell with n neighbours is alive next.  This is a tree of muxes on the
+//count bits whose leaves are 0, ~0, c or ~c.  For a constant rule the
+//compiler folds it down to a handful of operations.
+#define LIFE_LEAF(n, set1) ((set1(-(int64_t)(birth >> (n) & 1))) ^ (c & set1(-(int64_t)((birth ^ survive) >> (n) & 1))))
+#define LIFE_SET1_WORD(v) ((uint64_t)(v))
+
+static inline uint64_t life_mux(uint64_t s, uint64_t lo, uint64_t hi) {
+	return lo ^ ((lo ^ hi) & s);
+}
+
+static inline uint64_t life_rule(uint64_t c, uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3, const uint32_t birth, const uint32_t survive) {
+	uint64_t n01, n23, n45, n67;
+	
+	n01 = life_mux(s0,LIFE_LEAF(0,LIFE_SET1_WORD),LIFE_LEAF(1,LIFE_SET1_WORD));
+	n23 = life_mux(s0,LIFE_LEAF(2,LIFE_SET1_WORD),LIFE_LEAF(3,LIFE_SET1_WORD));
+	n45 = life_mux(s0,LIFE_LEAF(4,LIFE_SET1_WORD),LIFE_LEAF(5,LIFE_SET1_WORD));
+	n67 = life_mux(s0,LIFE_LEAF(6,LIFE_SET1_WORD),LIFE_LEAF(7,LIFE_SET1_WORD));
+	//A count of 8 has s0 to s2 clear
+	return life_mux(s3,life_mux(s2,life_mux(s1,n01,n23),life_mux(s1,n45,n67)),LIFE_LEAF(8,LIFE_SET1_WORD));
+}
+
+//Next generation of words words of row mid (64 cells a word), given
+//the rows above and below.  The eight neighbours are summed bit-sliced
+//by a tree of full adders into count bits s0 (ones) to s3 (eights).
+static inline void life_kernel(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, const int reverse, const uint32_t birth, const uint32_t survive) {
+	uint64_t a, aw, ae, c, cw, ce, b, bw, be;
+	uint64_t a0, a1, b0, b1, c0, c1;
+	uint64_t s0, s1, s2, s3, t, k1, k2, k4;
+	size_t off;
+	size_t i;
+	
+	for( i=0; i<words; i++ ) {
+		off = i*8;
+		a = life_load(up+off);
+		aw = life_west(up+off,a,reverse);
+		ae = life_east(up+off,a,reverse);
+		c = life_load(mid+off);
+		cw = life_west(mid+off,c,reverse);
+		ce = life_east(mid+off,c,reverse);
+		b = life_load(down+off);
+		bw = life_west(down+off,b,reverse);
+		be = life_east(down+off,b,reverse);
+		
+		//Rows above and below: three cells each
+		a0 = aw ^ a ^ ae;
+		a1 = (aw & a) | (ae & (aw ^ a));
+		b0 = bw ^ b ^ be;
+		b1 = (bw & b) | (be & (bw ^ b));
+		//Own row: two cells
+		c0 = cw ^ ce;
+		c1 = cw & ce;
+		
+		s0 = a0 ^ b0 ^ c0;
+		k1 = (a0 & b0) | (c0 & (a0 ^ b0));
+		t = a1 ^ b1 ^ c1;
+		k2 = (a1 & b1) | (c1 & (a1 ^ b1));
+		s1 = t ^ k1;
+		k4 = t & k1;
+		s2 = k2 ^ k4;
+		s3 = k2 & k4;
+		
+		c = life_rule(c,s0,s1,s2,s3,birth,survive);
+		memcpy(out+off,&c,8);
+	}
+}
+
+typedef void (*life_row_fn)(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, int reverse);
+
+//Call the instance of kernel for the bit order and rule.  Conway's
+//rule gets instances of its own with the rule built in.
+#define LIFE_INSTANCE(kernel) { \
+	if( life_birth == LIFE_CONWAY_BIRTH && life_survive == LIFE_CONWAY_SURVIVE ) { \
+		if( reverse ) { \
+			kernel(out,up,mid,down,words,1,LIFE_CONWAY_BIRTH,LIFE_CONWAY_SURVIVE); \
+		} \
+		else { \
+			kernel(out,up,mid,down,words,0,LIFE_CONWAY_BIRTH,LIFE_CONWAY_SURVIVE); \
+		} \
+	} \
+	else if( reverse ) { \
+		kernel(out,up,mid,down,words,1,life_birth,life_survive); \
+	} \
+	else { \
+		kernel(out,up,mid,down,words,0,life_birth,life_survive); \
+	} \
+}
+
+static void life_row_word(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, int reverse) {
+	LIFE_INSTANCE(life_kernel);
+}
+
+static inline int life_bit(const uint8_t* row, ptrdiff_t x, int reverse) {
+	return (row[x >> 3] >> (reverse ? x & 7 : 7 - (x & 7))) & 1;
+}
+
+//A cell at a time, counting neighbours one by one: the reference the
+//others must agree with
+static void life_row_cell(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, int reverse) {
+	ptrdiff_t x;
+	int n;
+	
+	memset(out,0,words*8);
+	for( x=0; x<(ptrdiff_t)words*64; x++ ) {
+		n = life_bit(up,x-1,reverse) + life_bit(up,x,reverse) + life_bit(up,x+1,reverse) +
+		    life_bit(mid,x-1,reverse) + life_bit(mid,x+1,reverse) +
+		    life_bit(down,x-1,reverse) + life_bit(down,x,reverse) + life_bit(down,x+1,reverse);
+		if( ((life_bit(mid,x,reverse) ? life_survive : life_birth) >> n) & 1 ) {
+			out[x >> 3] |= 1 << (reverse ? x & 7 : 7 - (x & 7));
+		}
+	}
+}
+
+#ifdef SIMD_X86
+//The same kernel 256 and 512 cells at a time
+
+__attribute__((target("avx2")))
+static inline __m256i life_west_avx2(const uint8_t* src, __m256i v, const int reverse) {
+	__m256i p = _mm256_loadu_si256((const __m256i*)(src-1));
+	
+	if( reverse ) {
+		return _mm256_or_si256(
+			_mm256_and_si256(_mm256_slli_epi64(v,1),_mm256_set1_epi8((char)0xFE)),
+			_mm256_and_si256(_mm256_srli_epi64(p,7),_mm256_set1_epi8(0x01)));
+	}
+	return _mm256_or_si256(
+		_mm256_and_si256(_mm256_srli_epi64(v,1),_mm256_set1_epi8(0x7F)),
+		_mm256_and_si256(_mm256_slli_epi64(p,7),_mm256_set1_epi8((char)0x80)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i life_east_avx2(const uint8_t* src, __m256i v, const int reverse) {
+	__m256i p = _mm256_loadu_si256((const __m256i*)(src+1));
+	
+	if( reverse ) {
+		return _mm256_or_si256(
+			_mm256_and_si256(_mm256_srli_epi64(v,1),_mm256_set1_epi8(0x7F)),
+			_mm256_and_si256(_mm256_slli_epi64(p,7),_mm256_set1_epi8((char)0x80)));
+	}
+	return _mm256_or_si256(
+		_mm256_and_si256(_mm256_slli_epi64(v,1),_mm256_set1_epi8((char)0xFE)),
+		_mm256_and_si256(_mm256_srli_epi64(p,7),_mm256_set1_epi8(0x01)));
+}
+
+//Sum and carry of a full adder
+#define LIFE_ADD_AVX2(s, k, x, y, z) { \
+	s = _mm256_xor_si256(_mm256_xor_si256(x,y),z); \
+	k = _mm256_or_si256(_mm256_and_si256(x,y),_mm256_and_si256(z,_mm256_xor_si256(x,y))); \
+}
+
+__attribute__((target("avx2")))
+static inline __m256i life_mux_avx2(__m256i s, __m256i lo, __m256i hi) {
+	return _mm256_xor_si256(lo,_mm256_and_si256(_mm256_xor_si256(lo,hi),s));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i life_rule_avx2(__m256i c, __m256i s0, __m256i s1, __m256i s2, __m256i s3, const uint32_t birth, const uint32_t survive) {
+	__m256i n01, n23, n45, n67;
+	
+	n01 = life_mux_avx2(s0,LIFE_LEAF(0,_mm256_set1_epi64x),LIFE_LEAF(1,_mm256_set1_epi64x));
+	n23 = life_mux_avx2(s0,LIFE_LEAF(2,_mm256_set1_epi64x),LIFE_LEAF(3,_mm256_set1_epi64x));
+	n45 = life_mux_avx2(s0,LIFE_LEAF(4,_mm256_set1_epi64x),LIFE_LEAF(5,_mm256_set1_epi64x));
+	n67 = life_mux_avx2(s0,LIFE_LEAF(6,_mm256_set1_epi64x),LIFE_LEAF(7,_mm256_set1_epi64x));
+	return life_mux_avx2(s3,life_mux_avx2(s2,life_mux_avx2(s1,n01,n23),life_mux_avx2(s1,n45,n67)),LIFE_LEAF(8,_mm256_set1_epi64x));
+}
+
+__attribute__((target("avx2")))
+static inline void life_kernel_avx2(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, const int reverse, const uint32_t birth, const uint32_t survive) {
+	__m256i a, aw, ae, c, cw, ce, b, bw, be;
+	__m256i a0, a1, b0, b1, c0, c1;
+	__m256i s0, s1, s2, s3, t, k1, k2, k4;
+	size_t off;
+	
+	for( off=0; off<words*8; off+=32 ) {
+		a = _mm256_loadu_si256((const __m256i*)(up+off));
+		aw = life_west_avx2(up+off,a,reverse);
+		ae = life_east_avx2(up+off,a,reverse);
+		c = _mm256_loadu_si256((const __m256i*)(mid+off));
+		cw = life_west_avx2(mid+off,c,reverse);
+		ce = life_east_avx2(mid+off,c,reverse);
+		b = _mm256_loadu_si256((const __m256i*)(down+off));
+		bw = life_west_avx2(down+off,b,reverse);
+		be = life_east_avx2(down+off,b,reverse);
+		
+		LIFE_ADD_AVX2(a0,a1,aw,a,ae);
+		LIFE_ADD_AVX2(b0,b1,bw,b,be);
+		c0 = _mm256_xor_si256(cw,ce);
+		c1 = _mm256_and_si256(cw,ce);
+		
+		LIFE_ADD_AVX2(s0,k1,a0,b0,c0);
+		LIFE_ADD_AVX2(t,k2,a1,b1,c1);
+		s1 = _mm256_xor_si256(t,k1);
+		k4 = _mm256_and_si256(t,k1);
+		s2 = _mm256_xor_si256(k2,k4);
+		s3 = _mm256_and_si256(k2,k4);
+		
+		c = life_rule_avx2(c,s0,s1,s2,s3,birth,survive);
+		_mm256_storeu_si256((__m256i*)(out+off),c);
+	}
+}
+
+__attribute__((target("avx2")))
+static void life_row_avx2(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, int reverse) {
+	LIFE_INSTANCE(life_kernel_avx2);
+}
+
+//With vpternlogq, each lane shift and each adder output is one
+//instruction (0xCA: a ? b : c, 0x96: parity, 0xE8: majority)
+__attribute__((target("avx512f")))
+static inline __m512i life_west_avx512(const uint8_t* src, __m512i v, const int reverse) {
+	__m512i p = _mm512_loadu_si512((const void*)(src-1));
+	
+	if( reverse ) {
+		return _mm512_ternarylogic_epi64(_mm512_set1_epi8((char)0xFE),_mm512_slli_epi64(v,1),_mm512_srli_epi64(p,7),0xCA);
+	}
+	return _mm512_ternarylogic_epi64(_mm512_set1_epi8(0x7F),_mm512_srli_epi64(v,1),_mm512_slli_epi64(p,7),0xCA);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i life_east_avx512(const uint8_t* src, __m512i v, const int reverse) {
+	__m512i p = _mm512_loadu_si512((const void*)(src+1));
+	
+	if( reverse ) {
+		return _mm512_ternarylogic_epi64(_mm512_set1_epi8(0x7F),_mm512_srli_epi64(v,1),_mm512_slli_epi64(p,7),0xCA);
+	}
+	return _mm512_ternarylogic_epi64(_mm512_set1_epi8((char)0xFE),_mm512_slli_epi64(v,1),_mm512_srli_epi64(p,7),0xCA);
+}
+
+//Each mux and each leaf (0x78: a ^ (b & c)) is one vpternlogq.  Conway
+//only needs two.
+__attribute__((target("avx512f")))
+static inline __m512i life_rule_avx512(__m512i c, __m512i s0, __m512i s1, __m512i s2, __m512i s3, const uint32_t birth, const uint32_t survive) {
+	__m512i l[9];
+	int n;
+	
+	if( birth == LIFE_CONWAY_BIRTH && survive == LIFE_CONWAY_SURVIVE ) {
+		//s1 & ~s2 & ~s3, then & (s0 | c)
+		return _mm512_ternarylogic_epi64(_mm512_ternarylogic_epi64(s1,s2,s3,0x10),s0,c,0xE0);
+	}
+	for( n=0; n<9; n++ ) {
+		l[n] = _mm512_ternarylogic_epi64(
+			_mm512_set1_epi64(-(int64_t)(birth >> n & 1)),c,
+			_mm512_set1_epi64(-(int64_t)((birth ^ survive) >> n & 1)),0x78);
+	}
+	for( n=0; n<4; n++ ) {
+		l[n] = _mm512_ternarylogic_epi64(s0,l[2*n+1],l[2*n],0xCA);
+	}
+	for( n=0; n<2; n++ ) {
+		l[n] = _mm512_ternarylogic_epi64(s1,l[2*n+1],l[2*n],0xCA);
+	}
+	l[0] = _mm512_ternarylogic_epi64(s2,l[1],l[0],0xCA);
+	return _mm512_ternarylogic_epi64(s3,l[8],l[0],0xCA);
+}
+
+__attribute__((target("avx512f")))
+static inline void life_kernel_avx512(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, const int reverse, const uint32_t birth, const uint32_t survive) {
+	__m512i a, aw, ae, c, cw, ce, b, bw, be;
+	__m512i a0, a1, b0, b1, c0, c1;
+	__m512i s0, s1, s2, s3, t, k1, k2, k4;
+	size_t off;
+	
+	for( off=0; off<words*8; off+=64 ) {
+		a = _mm512_loadu_si512((const void*)(up+off));
+		aw = life_west_avx512(up+off,a,reverse);
+		ae = life_east_avx512(up+off,a,reverse);
+		c = _mm512_loadu_si512((const void*)(mid+off));
+		cw = life_west_avx512(mid+off,c,reverse);
+		ce = life_east_avx512(mid+off,c,reverse);
+		b = _mm512_loadu_si512((const void*)(down+off));
+		bw = life_west_avx512(down+off,b,reverse);
+		be = life_east_avx512(down+off,b,reverse);
+		
+		a0 = _mm512_ternarylogic_epi64(aw,a,ae,0x96);
+		a1 = _mm512_ternarylogic_epi64(aw,a,ae,0xE8);
+		b0 = _mm512_ternarylogic_epi64(bw,b,be,0x96);
+		b1 = _mm512_ternarylogic_epi64(bw,b,be,0xE8);
+		c0 = _mm512_xor_si512(cw,ce);
+		c1 = _mm512_and_si512(cw,ce);
+		
+		s0 = _mm512_ternarylogic_epi64(a0,b0,c0,0x96);
+		k1 = _mm512_ternarylogic_epi64(a0,b0,c0,0xE8);
+		t = _mm512_ternarylogic_epi64(a1,b1,c1,0x96);
+		k2 = _mm512_ternarylogic_epi64(a1,b1,c1,0xE8);
+		s1 = _mm512_xor_si512(t,k1);
+		k4 = _mm512_and_si512(t,k1);
+		s2 = _mm512_xor_si512(k2,k4);
+		s3 = _mm512_and_si512(k2,k4);
+		
+		c = life_rule_avx512(c,s0,s1,s2,s3,birth,survive);
+		_mm512_storeu_si512((void*)(out+off),c);
+	}
+}
+
+__attribute__((target("avx512f")))
+static void life_row_avx512(uint8_t* out, const uint8_t* up, const uint8_t* mid, const uint8_t* down, size_t words, int reverse) {
+	LIFE_INSTANCE(life_kernel_avx512);
+}
+#endif //SIMD_X86
+
+//Census of a tile: how many cells are alive in out, how many of those
+//were dead in mid, and a hash of where they are.  Each live word is
+//hashed with its position in the grid, so the hash of a generation is
+//the sum over its tiles and can be kept up to date a tile at a time.
+struct life_census {
+	uint64_t hash;
+	uint64_t population;
+	uint64_t births;
+	uint64_t deaths;
+};
+
+typedef void (*life_census_fn)(struct life_census* census, const uint8_t* out, const uint8_t* mid, size_t rows, size_t stride, uint64_t pos);
+
+//Two products of the halves of the word, each keyed by its position
+//(as in NH), with one turned round so they don't cancel out
+#define LIFE_HASH_KEY1 0x9E3779B97F4A7C15ull
+#define LIFE_HASH_KEY2 0xC2B2AE3D27D4EB4Full
+
+static inline uint64_t life_hash_word(uint64_t v, uint64_t pos) {
+	uint64_t a = v ^ pos*LIFE_HASH_KEY1;
+	uint64_t b = v ^ pos*LIFE_HASH_KEY2;
+	uint64_t p = (a & 0xFFFFFFFF) * (a >> 32);
+	uint64_t q = (b & 0xFFFFFFFF) * (b >> 32);
+	
+	return p + (q << 32 | q >> 32);
+}
+
+static inline void life_census_kernel(struct life_census* census, const uint8_t* out, const uint8_t* mid, size_t rows, size_t stride, uint64_t pos) {
+	uint64_t hash = 0, population = 0, births = 0;
+	uint64_t o, m;
+	size_t y, i;
+	
+	for( y=0; y<rows; y++, out+=stride, mid+=stride, pos+=stride ) {
+		for( i=0; i<LIFE_TILE_BYTES; i+=8 ) {
+			memcpy(&o,out+i,8);
+			memcpy(&m,mid+i,8);
+			population += __builtin_popcountll(o);
+			births += __builtin_popcountll(o & ~m);
+			//Empty words don't count, wherever they are
+			hash += life_hash_word(o,pos+i) & -(uint64_t)(o != 0);
+		}
+	}
+	census->hash += hash;
+	census->population += population;
+	census->births += births;
+}
+
+static void life_census_word(struct life_census* census, const uint8_t* out, const uint8_t* mid, size_t rows, size_t stride, uint64_t pos) {
+	life_census_kernel(census,out,mid,rows,stride,pos);
+}
+
+#ifdef SIMD_X86
+__attribute__((target("popcnt")))
+static void life_census_popcnt(struct life_census* census, const uint8_t* out, const uint8_t* mid, size_t rows, size_t stride, uint64_t pos) {
+	life_census_kernel(census,out,mid,rows,stride,pos);
+}
+
+//A tile row at a time
+__attribute__((target("avx512f,avx512dq,avx512vpopcntdq")))
+static void life_census_avx512(struct life_census* census, const uint8_t* out, const uint8_t* mid, size_t rows, size_t stride, uint64_t pos) {
+	__m512i hash = _mm512_setzero_si512();
+	__m512i population = _mm512_setzero_si512();
+	__m512i births = _mm512_setzero_si512();
+	__m512i lane = _mm512_add_epi64(_mm512_set1_epi64(pos),_mm512_set_epi64(56,48,40,32,24,16,8,0));
+	__m512i key1 = _mm512_mullo_epi64(lane,_mm512_set1_epi64(LIFE_HASH_KEY1));
+	__m512i key2 = _mm512_mullo_epi64(lane,_mm512_set1_epi64(LIFE_HASH_KEY2));
+	__m512i step1 = _mm512_set1_epi64(stride*LIFE_HASH_KEY1);
+	__m512i step2 = _mm512_set1_epi64(stride*LIFE_HASH_KEY2);
+	__m512i o, m, a, b;
+	size_t y;
+	
+	for( y=0; y<rows; y++, out+=stride, mid+=stride ) {
+		o = _mm512_loadu_si512(out);
+		m = _mm512_loadu_si512(mid);
+		population = _mm512_add_epi64(population,_mm512_popcnt_epi64(o));
+		births = _mm512_add_epi64(births,_mm512_popcnt_epi64(_mm512_andnot_si512(m,o)));
+		a = _mm512_xor_si512(o,key1);
+		b = _mm512_xor_si512(o,key2);
+		a = _mm512_mul_epu32(a,_mm512_srli_epi64(a,32));
+		b = _mm512_mul_epu32(b,_mm512_srli_epi64(b,32));
+		a = _mm512_add_epi64(a,_mm512_rol_epi64(b,32));
+		hash = _mm512_mask_add_epi64(hash,_mm512_test_epi64_mask(o,o),hash,a);
+		key1 = _mm512_add_epi64(key1,step1);
+		key2 = _mm512_add_epi64(key2,step2);
+	}
+	census->hash += _mm512_reduce_add_epi64(hash);
+	census->population += _mm512_reduce_add_epi64(population);
+	census->births += _mm512_reduce_add_epi64(births);
+}
+#endif //SIMD_X86
+
+//Set bits in the len Bytes at p
+typedef uint64_t (*popcount_fn)(const uint8_t* p, size_t len);
+
+static inline uint64_t popcount_kernel(const uint8_t* p, size_t len) {
+	uint64_t count = 0;
+	size_t i;
+	
+	for( i=0; i+8<=len; i+=8 ) {
+		count += __builtin_popcountll(load_le64(p+i));
+	}
+	for( ; i<len; i++ ) {
+		count += __builtin_popcount(p[i]);
+	}
+	return count;
+}
+
+static uint64_t popcount_word(const uint8_t* p, size_t len) {
+	return popcount_kernel(p,len);
+}
+
+#ifdef SIMD_X86
+__attribute__((target("popcnt")))
+static uint64_t popcount_popcnt(const uint8_t* p, size_t len) {
+	return popcount_kernel(p,len);
+}
+
+//Count each nibble with a lookup, sum the Byte counts into 64 bit
+//lanes before they can overflow
+__attribute__((target("avx2,popcnt")))
+static uint64_t popcount_avx2(const uint8_t* p, size_t len) {
+	const __m256i lut = _mm256_setr_epi8(
+		0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+		0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+	const __m256i low = _mm256_set1_epi8(0x0F);
+	__m256i total = _mm256_setzero_si256();
+	__m256i sum, v;
+	size_t i = 0;
+	int j;
+	
+	while( len-i >= 32 ) {
+		sum = _mm256_setzero_si256();
+		for( j=0; j<31 && len-i >= 32; j++, i+=32 ) {
+			v = _mm256_loadu_si256((const __m256i*)(p+i));
+			sum = _mm256_add_epi8(sum,_mm256_add_epi8(
+				_mm256_shuffle_epi8(lut,_mm256_and_si256(v,low)),
+				_mm256_shuffle_epi8(lut,_mm256_and_si256(_mm256_srli_epi16(v,4),low))));
+		}
+		total = _mm256_add_epi64(total,_mm256_sad_epu8(sum,_mm256_setzero_si256()));
+	}
+	return _mm256_extract_epi64(total,0) + _mm256_extract_epi64(total,1) +
+	       _mm256_extract_epi64(total,2) + _mm256_extract_epi64(total,3) +
+	       popcount_kernel(p+i,len-i);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static uint64_t popcount_avx512(const uint8_t* p, size_t len) {
+	__m512i total = _mm512_setzero_si512();
+	size_t i;
+	
+	for( i=0; i+64<=len; i+=64 ) {
+		total = _mm512_add_epi64(total,_mm512_popcnt_epi64(_mm512_loadu_si512(p+i)));
+	}
+	return _mm512_reduce_add_epi64(total) + popcount_kernel(p+i,len-i);
+}
+#endif //SIMD_X86
+
+static sextant_expand_fn sextant_expand = sextant_expand_word;
+static popcount_fn popcount_bytes = popcount_word;
+static glyph_expand_fn octant_expand = octant_expand_word;
+static glyph_expand_fn quadrant_expand = quadrant_expand_word;
+static glyph_expand_fn half_expand = half_expand_word;
+static glyph_expand_fn glyph_expand = octant_expand_word;
+static life_row_fn life_row_step = life_row_word;
+static life_census_fn life_census_tile = life_census_word;
+
+//The Life kernels this CPU can run.  Each can step the world alone or
+//in bands across the thread pool; life_tune() times every combination
+//on the world and keeps the fastest.  Until then the widest kernel
+//runs, threaded.
+struct life_kernel_info {
+	const char* name;
+	life_row_fn fn;
+	uint64_t ns[2];
+};
+
+static struct life_kernel_info life_kernels[4];
+static int life_kernel_count = 0;
+static int life_kernel_pick = 0;
+static int life_kernel_threaded = 1;
+
+static void life_kernel_add(const char* name, life_row_fn fn) {
+	life_kernels[life_kernel_count].name = name;
+	life_kernels[life_kernel_count].fn = fn;
+	life_kernel_pick = life_kernel_count++;
+	life_row_step = fn;
+}
+
+//Pick the widest kernels the CPU supports.  Life's are listed for
+//life_tune() to choose between.
+static void simd_setup() {
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+#endif
+	life_kernel_add("cell",life_row_cell);
+	life_kernel_add("word",life_row_word);
+#ifdef SIMD_X86
+	if( __builtin_cpu_supports("avx2") ) {
+		life_kernel_add("avx2",life_row_avx2);
+	}
+	if( __builtin_cpu_supports("avx512f") ) {
+		life_kernel_add("avx512",life_row_avx512);
+	}
+	if( __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vpopcntdq") ) {
+		life_census_tile = life_census_avx512;
+	}
+	else if( __builtin_cpu_supports("popcnt") ) {
+		life_census_tile = life_census_popcnt;
+	}
+	if( __builtin_cpu_supports("avx512vpopcntdq") ) {
+		popcount_bytes = popcount_avx512;
+	}
+	else if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") ) {
+		popcount_bytes = popcount_avx2;
+	}
+	else if( __builtin_cpu_supports("popcnt") ) {
+		popcount_bytes = popcount_popcnt;
+	}
+	
+	if( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+		sextant_expand = sextant_expand_avx512;
+	}
+	else if( __builtin_cpu_supports("avx2") ) {
+		sextant_expand = sextant_expand_avx2;
+	}
+	//pdep is microcoded (and slow) before Zen 3
+	else if( __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam17h") && !__builtin_cpu_is("amdfam15h") ) {
+		sextant_expand = sextant_expand_bmi2;
+	}
+	else if( __builtin_cpu_supports("sse2") ) {
+		sextant_expand = sextant_expand_sse2;
+	}
+	
+	if( __builtin_cpu_supports("avx2") ) {
+		octant_expand = octant_expand_avx2;
+		quadrant_expand = quadrant_expand_avx2;
+		half_expand = half_expand_avx2;
+	}
+	else if( __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam17h") && !__builtin_cpu_is("amdfam15h") ) {
+		octant_expand = octant_expand_bmi2;
+		quadrant_expand = quadrant_expand_bmi2;
+		half_expand = half_expand_bmi2;
+	}
+#endif
+}
+
+//Fill out with the sextant indices of count cells whose top left pixel
+//is pixel x of rows[0].  Each row has lens[] valid Bytes; a row with
+//0 valid Bytes reads as blank.  Whole words of 32 cells go through
+//sextant_expand, the rest through a scalar tail.
+#define SEXTANT_BLOCK 64
+static void sextant_row(uint8_t* out, const uint8_t* rows[3], const size_t lens[3], size_t x, int count) {
+	uint64_t a[SEXTANT_BLOCK], b[SEXTANT_BLOCK], c[SEXTANT_BLOCK];
+	int i, n, s;
+	
+	while( count >= 32 ) {
+		n = count/32 < SEXTANT_BLOCK ? count/32 : SEXTANT_BLOCK;
+		for( i=0; i<n; i++ ) {
+			a[i] = row_pairs(rows[0],lens[0],x+i*64);
+			b[i] = row_pairs(rows[1],lens[1],x+i*64);
+			c[i] = row_pairs(rows[2],lens[2],x+i*64);
+		}
+		sextant_expand(out,a,b,c,n);
+		out += n*32;
+		count -= n*32;
+		x += n*64;
+	}
+	if( count > 0 ) {
+		a[0] = row_pairs(rows[0],lens[0],x);
+		b[0] = row_pairs(rows[1],lens[1],x);
+		c[0] = row_pairs(rows[2],lens[2],x);
+		for( i=0; i<count; i++ ) {
+			s = 2*i;
+			out[i] = (((a[0]>>s)&3)<<4) | (((b[0]>>s)&3)<<2) | ((c[0]>>s)&3);
+		}
+	}
+}
+
+//Fill out with the glyph indices of count cells whose top left pixel
+//is pixel x of rows[0], as sextant_row() does for any glyph_mode.  Rows
+//past glyph_h are not read.
+static void glyph_row(uint8_t* out, const uint8_t* rows[4], const size_t lens[4], size_t x, int count) {
+	uint64_t words[4][SEXTANT_BLOCK];
+	const uint64_t* p[4] = {words[0],words[1],words[2],words[3]};
+	uint8_t tail[64];
+	int per_word = 64/glyph_w;
+	int i, r, n;
+	
+	if( glyph_mode == GLYPH_SEXTANT ) {
+		sextant_row(out,rows,lens,x,count);
+		return;
+	}
+	while( count > 0 ) {
+		n = (count+per_word-1)/per_word;
+		if( n > SEXTANT_BLOCK ) {
+			n = SEXTANT_BLOCK;
+		}
+		for( r=0; r<glyph_h; r++ ) {
+			for( i=0; i<n; i++ ) {
+				words[r][i] = glyph_w == 1 ? row_bits(rows[r],lens[r],x+i*64) : row_pairs(rows[r],lens[r],x+i*64);
+			}
+		}
+		//A last partial word goes through tail so out is not overrun
+		if( count < n*per_word ) {
+			if( --n ) {
+				glyph_expand(out,p,n);
+			}
+			for( r=0; r<glyph_h; r++ ) {
+				words[r][0] = words[r][n];
+			}
+			glyph_expand(tail,p,1);
+			memcpy(out+n*per_word,tail,count-n*per_word);
+			return;
+		}
+		glyph_expand(out,p,n);
+		out += n*per_word;
+		count -= n*per_word;
+		x += n*64;
+	}
+}
+
+//The character for glyph index i of the mode.  Indices hold the rows of
+//the cell top first, left pixel high (see glyph_expand_fn).
+static uint32_t glyph_char(int i) {
+	//Braille dots 1-3 and 7 down the left, 4-6 and 8 down the right
+	static const uint8_t dots[4][2] = {{0x01,0x08},{0x02,0x10},{0x04,0x20},{0x40,0x80}};
+	uint32_t c;
+	int r, k, mask;
+	
+	switch( glyph_mode ) {
+	case GLYPH_BRAILLE:
+		c = 0;
+		for( r=0; r<4; r++ ) {
+			if( i & (2<<(6-2*r)) ) {
+				c |= dots[r][0];
+			}
+			if( i & (1<<(6-2*r)) ) {
+				c |= dots[r][1];
+			}
+		}
+		return 0x2800+c;
+	case GLYPH_OCTANT:
+		mask = 0;
+		for( r=0; r<4; r++ ) {
+			mask |= ((i>>(6-2*r))&1) << (2*r+1);
+			mask |= ((i>>(7-2*r))&1) << (2*r);
+		}
+		c = 0x1CD00+mask;
+		for( k=0; k<(int)(sizeof(octant_older)/sizeof(octant_older[0])); k++ ) {
+			if( octant_older[k].mask == mask ) {
+				return octant_older[k].c;
+			}
+			if( octant_older[k].mask < mask ) {
+				c--;
+			}
+		}
+		return c;
+	case GLYPH_QUADRANT:
+		return quadrant_chars[i&15];
+	case GLYPH_HALF:
+		return half_chars[i&3];
+	default:
+		return sextant_chars[i&63];
+	}
+}
+
+//Build the tables for glyph_mode; simd_setup() must have run
+static void glyph_setup() {
+	static const int sizes[][2] = {{2,3},{2,4},{2,4},{2,2},{1,2}};
+	static glyph_expand_fn* expands[] = {NULL,&octant_expand,&octant_expand,&quadrant_expand,&half_expand};
+	int i;
+	char* encoded;
+	
+	glyph_w = sizes[glyph_mode][0];
+	glyph_h = sizes[glyph_mode][1];
+	if( expands[glyph_mode] ) {
+		glyph_expand = *expands[glyph_mode];
+	}
+	for( i=0; i<256; i++ ) {
+		encoded = utf8_encode(0,glyph_char(i));
+		glyph_utf8_len[i] = strlen(encoded);
+		memcpy(glyph_utf8[i],encoded,glyph_utf8_len[i]);
+	}
+}
+
+//Make sure at least len more Bytes can be appended to out_buffer
+static void out_reserve(size_t len) {
+	char* tmp;
+	
+	if( out_len + len <= out_size ) {
+		return;
+	}
+	errno = 0;
+	tmp = realloc(out_buffer,out_len+len);
+	if( !tmp ) {
+		free(out_buffer);
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	out_buffer = tmp;
+	out_size = out_len+len;
+}
+
+static void out_write(const char* data, size_t len) {
+	out_reserve(len);
+	memcpy(out_buffer+out_len,data,len);
+	out_len += len;
+}
+
+//Append the glyph for a glyph index.  Caller must have reserved
+//4 Bytes.
+static inline void out_glyph(uint8_t index) {
+	memcpy(out_buffer+out_len,glyph_utf8[index],4);
+	out_len += glyph_utf8_len[index];
+}
+
+//Send everything in out_buffer to the terminal with as few write()
+//calls as the terminal will accept
+static void out_flush() {
+	size_t pos = 0;
+	ssize_t len;
+	struct pollfd pfd;
+	
+	//Anything left in stdio (status messages) must go first
+	fflush(stdout);
+	while( pos < out_len ) {
+		len = write(STDOUT_FILENO,out_buffer+pos,out_len-pos);
+		if( len < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			//stdout usually shares the (non-blocking) file description
+			//of stdin, so wait for the terminal to drain
+			if( errno == EAGAIN ) {
+				pfd.fd = STDOUT_FILENO;
+				pfd.events = POLLOUT;
+				poll(&pfd,1,-1);
+				continue;
+			}
+			break;
+		}
+		pos += len;
+	}
+	out_len = 0;
+}
+
+//Cells of unchanged glyphs shorter than this are re-sent rather than
+//skipped with a cursor move
+#define FRAME_GAP 2
+
+//Size the glyph index grids for the terminal.  A change in size forces
+//the next frame_draw() to repaint everything.
+static void frame_setup(int w, int h) {
+	uint8_t* tmp[3];
+	
+	if( w == frame_w && h == frame_h ) {
+		return;
+	}
+	errno = 0;
+	tmp[0] = realloc(frame,w*h);
+	tmp[1] = realloc(last_frame,w*h);
+	tmp[2] = realloc(frame_dirty,h);
+	if( !tmp[0] || !tmp[1] || !tmp[2] ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	frame = tmp[0];
+	last_frame = tmp[1];
+	frame_dirty = tmp[2];
+	frame_w = w;
+	frame_h = h;
+	frame_valid = 0;
+}
+
+//Something other than frame_draw() wrote to row y
+static void frame_invalidate_row(int y) {
+	if( y >= 0 && y < frame_h ) {
+		frame_dirty[y] = 1;
+	}
+}
+
+//Show text on the bottom row until it is next drawn.  It is clipped to
+//the terminal width so the line can't wrap and scroll the frame.
+static void show_status(const char* text) {
+	printf("\x1b[%d;1H%.*s",frame_h,frame_w,text);
+	fflush(stdout);
+	frame_invalidate_row(frame_h-1);
+}
+
+//Whether a key is waiting to be read
+static int key_waiting() {
+	struct pollfd pfd;
+	
+	pfd.fd = STDIN_FILENO;
+	pfd.events = POLLIN;
+	return poll(&pfd,1,0) > 0;
+}
+
+//The terminal is about to show the same picture moved up n rows (down
+//for negative n) within rows 0 to h-1.  Let the terminal scroll it and
+//shift last_frame to match, so only the exposed rows get redrawn.
+static void frame_scroll(int n, int h) {
+	int rows;
+	
+	if( !frame_valid || n == 0 || n >= h || -n >= h || h > frame_h ) {
+		return;
+	}
+	rows = n > 0 ? n : -n;
+	out_reserve(32);
+	out_len += sprintf(out_buffer+out_len,"\x1b[1;%dr",h);
+	if( n > 0 ) {
+		out_len += sprintf(out_buffer+out_len,"\x1b[%dS",rows);
+		memmove(last_frame,last_frame+rows*frame_w,(h-rows)*frame_w);
+		memmove(frame_dirty,frame_dirty+rows,h-rows);
+		memset(last_frame+(h-rows)*frame_w,0,rows*frame_w);
+		memset(frame_dirty+(h-rows),0,rows);
+	}
+	else {
+		out_len += sprintf(out_buffer+out_len,"\x1b[%dT",rows);
+		memmove(last_frame+rows*frame_w,last_frame,(h-rows)*frame_w);
+		memmove(frame_dirty+rows,frame_dirty,h-rows);
+		memset(last_frame,0,rows*frame_w);
+		memset(frame_dirty,0,rows);
+	}
+	out_write("\x1b[r",3);
+}
+
+static void out_cursor(int x, int y) {
+	out_reserve(16);
+	out_len += sprintf(out_buffer+out_len,"\x1b[%d;%dH",y+1,x+1);
+}
+
+//Append the escapes and glyphs needed to turn the terminal contents
+//(last_frame) into the first h rows of frame.  Only changed spans are
+//sent.
+static void frame_draw(int h) {
+	int x, y;
+	int start, end;
+	int cur_x, cur_y;
+	uint8_t* row;
+	uint8_t* last;
+	
+	if( !frame_valid ) {
+		out_write("\x1b[2J\x1b[H\x1b[0m",11);
+		memset(last_frame,0,frame_w*frame_h);
+		memset(frame_dirty,0,frame_h);
+		frame_valid = 1;
+	}
+	
+	cur_x = -1;
+	cur_y = -1;
+	for( y=0; y<h; y++ ) {
+		row = frame + y*frame_w;
+		last = last_frame + y*frame_w;
+		if( !frame_dirty[y] && !memcmp(row,last,frame_w) ) {
+			continue;
+		}
+		x = 0;
+		while( x < frame_w ) {
+			if( !frame_dirty[y] && row[x] == last[x] ) {
+				x++;
+				continue;
+			}
+			start = x;
+			end = x+1;
+			for( x=end; x<frame_w && x-end<FRAME_GAP; x++ ) {
+				if( frame_dirty[y] || row[x] != last[x] ) {
+					end = x+1;
+				}
+			}
+			x = end;
+			if( cur_y >= 0 && cur_y == y-1 && start == 0 ) {
+				out_write("\r\n",2);
+			}
+			else if( cur_y == y && cur_x >= 0 && cur_x < start ) {
+				out_reserve(16);
+				out_len += sprintf(out_buffer+out_len,"\x1b[%dC",start-cur_x);
+			}
+			else if( cur_x != start || cur_y != y ) {
+				out_cursor(start,y);
+			}
+			out_reserve((end-start)*4);
+			for( ; start<end; start++ ) {
+				out_glyph(row[start]);
+			}
+			//Writing the last column leaves the cursor in a pending
+			//wrap state, so its position must be re-sent
+			cur_x = end < frame_w ? end : -1;
+			cur_y = y;
+		}
+		memcpy(last,row,frame_w);
+		frame_dirty[y] = 0;
+	}
+}
+
+//Map the whole file if it is a regular file or block device, so the
+//view can be rendered without copying it
+static void map_file() {
+	struct stat st;
+	void* map;
+	
+	if( fstat(fd,&st) < 0 || !(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)) ) {
+		return;
+	}
+	if( fd_size <= 0 || (uint64_t)fd_size > SIZE_MAX ) {
+		return;
+	}
+	map = mmap(0,fd_size,PROT_READ,MAP_SHARED,fd,0);
+	if( map == MAP_FAILED ) {
+		return;
+	}
+	file_map = map;
+	//Nothing is known about the access pattern yet, and jumps around a
+	//large image shouldn't pull in readahead the view will never show
+	file_map_advice = MADV_RANDOM;
+	madvise(file_map,fd_size,file_map_advice);
+}
+
+//Data extents of the file, in order.  Everything between them is a
+//hole, which reads as zeros.
+struct extent {
+	off_t start;
+	off_t end;
+};
+
+static struct extent* extents = 0;
+static size_t extent_count = 0;
+static int hole_map = 0;
+
+//Build the extent list with SEEK_DATA/SEEK_HOLE.  Where the filesystem
+//(or device) can't tell, the rest of the file is taken to be data.
+static void find_extents() {
+	size_t size = 0;
+	off_t start;
+	off_t end = 0;
+	struct extent* tmp;
+	
+	while( end < fd_size ) {
+		start = lseek(fd,end,SEEK_DATA);
+		if( start < 0 && errno == ENXIO ) {
+			break;
+		}
+		if( start < 0 ) {
+			start = end;
+			end = fd_size;
+		}
+		else {
+			end = lseek(fd,start,SEEK_HOLE);
+			if( end < 0 || end > fd_size ) {
+				end = fd_size;
+			}
+		}
+		if( start >= end ) {
+			break;
+		}
+		if( extent_count == size ) {
+			size = size ? size*2 : 64;
+			errno = 0;
+			tmp = realloc(extents,size*sizeof(struct extent));
+			if( !tmp ) {
+				ERROR("Memory allocation error: %s\n",strerror(errno));
+			}
+			extents = tmp;
+		}
+		extents[extent_count].start = start;
+		extents[extent_count].end = end;
+		extent_count++;
+	}
+}
+
+//Index of the first extent that ends after pos (extent_count if none)
+static size_t extent_after(off_t pos) {
+	size_t lo = 0;
+	size_t hi = extent_count;
+	size_t mid;
+	
+	while( lo < hi ) {
+		mid = (lo+hi)/2;
+		if( extents[mid].end <= pos ) {
+			lo = mid+1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+//Whether the len Bytes at pos are all hole
+static int in_hole(off_t pos, size_t len) {
+	size_t i = extent_after(pos);
+	
+	return i == extent_count || extents[i].start >= pos + (off_t)len;
+}
+
+//Move offset to the row that start falls in, keeping it on the same
+//row boundaries
+static void jump_to(off_t start) {
+	off_t row_len = (off_t)(buffer_width/8) << view_zoom;
+	
+	if( row_len ) {
+		offset = start - ((start - offset) % row_len + row_len) % row_len;
+	}
+}
+
+//Move offset to the next (dir > 0) or previous extent of data.  The
+//start of the extent lands in the first row of the view.
+static void jump_extent(int dir) {
+	off_t row_len = (off_t)(buffer_width/8) << view_zoom;
+	size_t i;
+	
+	if( !row_len ) {
+		return;
+	}
+	if( dir > 0 ) {
+		//Extents starting within the first row are already in view
+		i = extent_after(offset+row_len);
+		if( i < extent_count && extents[i].start < offset+row_len ) {
+			i++;
+		}
+		if( i >= extent_count ) {
+			return;
+		}
+	}
+	else {
+		i = extent_after(offset);
+		if( i == extent_count || extents[i].start >= offset ) {
+			if( i == 0 ) {
+				return;
+			}
+			i--;
+		}
+	}
+	jump_to(extents[i].start);
+}
+
+//Draw a map of the whole file over the bottom row: '#' where a column's
+//share of the file holds any data, '.' where it is all hole, with the
+//columns of the current view in reverse video
+static void draw_hole_map(int w, int y) {
+	off_t start, end;
+	int view, in_view = 0;
+	int x;
+	
+	out_cursor(0,y);
+	out_reserve(w*5+8);
+	for( x=0; x<w; x++ ) {
+		start = fd_size*x/w;
+		end = fd_size*(x+1)/w;
+		view = end > offset && start < offset + ((off_t)buffer_size << view_zoom);
+		if( view != in_view ) {
+			out_write(view ? "\x1b[7m" : "\x1b[0m",4);
+			in_view = view;
+		}
+		out_buffer[out_len++] = in_hole(start,end-start) ? '.' : '#';
+	}
+	out_write("\x1b[0m",4);
+}
+
+//Popcount pyramid of the whole file for the minimap, built by a thread
+//of its own.  Level 0 has the density of each PYRAMID_BLOCK Bytes, and
+//each level above sums up PYRAMID_FANOUT nodes of the one below.
+//Densities run from 0 to 255, and are only 0 where no bit is set.
+//The set bits of each block are kept exactly too, for zoomed out views.
+#define PYRAMID_BLOCK 4096
+#define PYRAMID_FANOUT 16
+#define PYRAMID_LEVELS 16
+#define PYRAMID_CHUNK (1024*1024)
+#define PYRAMID_NOTIFY_NS 100000000
+
+static uint8_t* pyramid[PYRAMID_LEVELS];
+static uint16_t* pyramid_bits = 0;
+static size_t pyramid_count[PYRAMID_LEVELS];
+static int pyramid_levels = 0;
+//Level 0 nodes done so far, from the start of the file
+static size_t pyramid_done = 0;
+static pthread_mutex_t pyramid_lock = PTHREAD_MUTEX_INITIALIZER;
+//Posted as the pyramid grows, so a shown minimap can be redrawn
+static int pyramid_event = -1;
+static int minimap = 0;
+static int minimap_rows = 0;
+
+static inline uint8_t pyramid_density(uint64_t count, uint64_t bits) {
+	uint64_t d = count*255/bits;
+	
+	return d ? d : count != 0;
+}
+
+static void pyramid_notify() {
+	uint64_t one = 1;
+	
+	if( write(pyramid_event,&one,sizeof(one)) < 0 ) {
+		//The count is already non-zero
+	}
+}
+
+static void* pyramid_thread(void* arg) {
+	size_t ready[PYRAMID_LEVELS] = {0};
+	struct timespec now;
+	int64_t last = 0, ns;
+	uint8_t* chunk;
+	off_t pos, len;
+	size_t node, end, k, c, n;
+	uint64_t sum;
+	int j;
+	
+	errno = 0;
+	chunk = malloc(PYRAMID_CHUNK);
+	if( !chunk ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	for( node=0; node<pyramid_count[0]; node=end ) {
+		pos = (off_t)node*PYRAMID_BLOCK;
+		len = fd_size-pos < PYRAMID_CHUNK ? fd_size-pos : PYRAMID_CHUNK;
+		end = node + (len+PYRAMID_BLOCK-1)/PYRAMID_BLOCK;
+		if( in_hole(pos,len) ) {
+			memset(pyramid[0]+node,0,end-node);
+			memset(pyramid_bits+node,0,(end-node)*sizeof(uint16_t));
+		}
+		else {
+			errno = 0;
+			if( pread(fd,chunk,len,pos) != len ) {
+				ERROR("File read error: %s\n",strerror(errno));
+			}
+			for( k=node; k<end; k++ ) {
+				n = len - (off_t)(k-node)*PYRAMID_BLOCK;
+				if( n > PYRAMID_BLOCK ) {
+					n = PYRAMID_BLOCK;
+				}
+				pyramid_bits[k] = popcount_bytes(chunk+(k-node)*PYRAMID_BLOCK,n);
+				pyramid[0][k] = pyramid_density(pyramid_bits[k],n*8);
+			}
+		}
+		ready[0] = end;
+		
+		//Nodes above whose children are all done
+		for( j=1; j<pyramid_levels; j++ ) {
+			c = ready[j-1] == pyramid_count[j-1] ? pyramid_count[j] : ready[j-1]/PYRAMID_FANOUT;
+			for( k=ready[j]; k<c; k++ ) {
+				sum = 0;
+				for( n=k*PYRAMID_FANOUT; n<(k+1)*PYRAMID_FANOUT && n<pyramid_count[j-1]; n++ ) {
+					sum += pyramid[j-1][n];
+				}
+				n -= k*PYRAMID_FANOUT;
+				pyramid[j][k] = sum/n ? sum/n : sum != 0;
+			}
+			ready[j] = c;
+		}
+		
+		pthread_mutex_lock(&pyramid_lock);
+		pyramid_done = end;
+		pthread_mutex_unlock(&pyramid_lock);
+		clock_gettime(CLOCK_MONOTONIC,&now);
+		ns = (int64_t)now.tv_sec*1000000000 + now.tv_nsec;
+		if( ns - last >= PYRAMID_NOTIFY_NS || end == pyramid_count[0] ) {
+			pyramid_notify();
+			last = ns;
+		}
+	}
+	free(chunk);
+	return arg;
+}
+
+//Size the levels and start building them, once
+static void pyramid_setup() {
+	pthread_t thread;
+	size_t count;
+	
+	if( pyramid_levels || fd_size <= 0 ) {
+		return;
+	}
+	count = (fd_size+PYRAMID_BLOCK-1)/PYRAMID_BLOCK;
+	errno = 0;
+	pyramid_bits = calloc(count,sizeof(uint16_t));
+	if( !pyramid_bits ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	while( pyramid_levels < PYRAMID_LEVELS ) {
+		errno = 0;
+		pyramid[pyramid_levels] = calloc(count,1);
+		if( !pyramid[pyramid_levels] ) {
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+		pyramid_count[pyramid_levels++] = count;
+		if( count == 1 ) {
+			break;
+		}
+		count = (count+PYRAMID_FANOUT-1)/PYRAMID_FANOUT;
+	}
+	if( (errno = pthread_create(&thread,0,pyramid_thread,0)) ) {
+		ERROR("Thread creation error: %s\n",strerror(errno));
+	}
+	pthread_detach(thread);
+}
+
+//Add up the densities of level j nodes in the Bytes from start to end,
+//each weighted by its size.  Nodes only partly in the range are taken
+//from the level below; blocks of level 0 count whole.
+static void pyramid_sum(int j, off_t size, off_t start, off_t end, uint64_t* sum, uint64_t* weight, int* any) {
+	off_t first, last;
+	size_t k;
+	
+	for( k=start/size; k<pyramid_count[j] && (off_t)k*size < end; k++ ) {
+		first = (off_t)k*size;
+		last = first+size < fd_size ? first+size : fd_size;
+		if( j > 0 && (first < start || last > end) ) {
+			pyramid_sum(j-1,size/PYRAMID_FANOUT,first > start ? first : start,last < end ? last : end,sum,weight,any);
+			continue;
+		}
+		*sum += (uint64_t)pyramid[j][k]*((last-first+PYRAMID_BLOCK-1)/PYRAMID_BLOCK);
+		*weight += (last-first+PYRAMID_BLOCK-1)/PYRAMID_BLOCK;
+		*any |= pyramid[j][k];
+	}
+}
+
+//Density of the Bytes from start to end, or -1 if not all of them
+//have been counted yet
+static int pyramid_range(off_t start, off_t end, size_t done) {
+	off_t size = PYRAMID_BLOCK;
+	uint64_t sum = 0;
+	uint64_t weight = 0;
+	int any = 0;
+	int j = 0;
+	
+	if( done < pyramid_count[0] && (size_t)((end-1)/PYRAMID_BLOCK) >= done ) {
+		return -1;
+	}
+	while( j+1 < pyramid_levels && size*PYRAMID_FANOUT <= end-start ) {
+		size *= PYRAMID_FANOUT;
+		j++;
+	}
+	pyramid_sum(j,size,start,end,&sum,&weight,&any);
+	if( !weight ) {
+		return 0;
+	}
+	sum /= weight;
+	return sum ? (int)sum : any != 0;
+}
+
+//Draw the minimap down column x over the top h rows: each row shades the
+//density of its share of the file, '·' where it isn't known yet, and
+//the rows of the current view are in reverse video
+static void draw_minimap(int x, int h) {
+	static const char* shades[] = {" ","\xe2\x96\x91","\xe2\x96\x92","\xe2\x96\x93","\xe2\x96\x88"};
+	off_t start, end;
+	off_t view_end = offset + ((off_t)buffer_size << view_zoom);
+	size_t done;
+	int d, y;
+	
+	pthread_mutex_lock(&pyramid_lock);
+	done = pyramid_done;
+	pthread_mutex_unlock(&pyramid_lock);
+	
+	out_reserve(h*16);
+	for( y=0; y<h; y++ ) {
+		start = fd_size*y/h;
+		end = fd_size*(y+1)/h;
+		out_cursor(x,y);
+		if( end > offset && start < view_end ) {
+			out_write("\x1b[7m",4);
+		}
+		d = end > start ? pyramid_range(start,end,done) : 0;
+		if( d < 0 ) {
+			out_write("\xc2\xb7",2);
+		}
+		else {
+			out_write(shades[d ? 1 + d*4/256 : 0],d ? 3 : 1);
+		}
+		out_write("\x1b[0m",4);
+	}
+}
+
+//Draw the generation and census of an evolved view over row y, or the
+//period once it has settled into a cycle
+static void draw_life_status(int w, int y) {
+	char status[160];
+	int len;
+	
+	if( wolfram_ring ) {
+		len = snprintf(status,sizeof(status),"Rule %d  Generation %llu",
+		               wolfram_rule,(unsigned long long)wolfram_generation);
+	}
+	else if( life_period == 1 ) {
+		len = snprintf(status,sizeof(status),"Generation %llu  Population %llu  Still since generation %llu",
+		               (unsigned long long)life_generation,(unsigned long long)life_population,
+		               (unsigned long long)(life_generation-1));
+	}
+	else if( life_period ) {
+		len = snprintf(status,sizeof(status),"Generation %llu  Population %llu  Period %llu since generation %llu",
+		               (unsigned long long)life_generation,(unsigned long long)life_population,
+		               (unsigned long long)life_period,(unsigned long long)(life_generation-life_period));
+	}
+	else {
+		len = snprintf(status,sizeof(status),"Generation %llu  Population %llu  Births %llu  Deaths %llu",
+		               (unsigned long long)life_generation,(unsigned long long)life_population,
+		               (unsigned long long)life_births,(unsigned long long)life_deaths);
+	}
+	if( !wolfram_ring ) {
+		len += snprintf(status+len,sizeof(status)-len,"  Kernel %s%s",life_kernels[life_kernel_pick].name,
+		                life_kernel_threaded ? " threaded" : "");
+		if( len >= (int)sizeof(status) ) {
+			len = sizeof(status)-1;
+		}
+	}
+	if( len > w ) {
+		len = w;
+	}
+	out_cursor(0,y);
+	out_write(status,len);
+	out_write("\x1b[K",3);
+	frame_invalidate_row(y);
+}
+
+//Block cache for sources that can't be mapped.  A prefetch thread
+//keeps it filled ahead of the view.  Spans of rows narrower than a
+//block are read straight from the file unless already cached, so a
+//windowed view doesn't read whole blocks to show a few Bytes of each.
+//Slots are found by block number through chained hash buckets.
+#define CACHE_BLOCK (16*1024)
+#define CACHE_BLOCKS 1024
+#define CACHE_BUCKETS 2048
+#define CACHE_RUN 64
+#define CACHE_EMPTY 0
+#define CACHE_LOADING 1
+#define CACHE_READY 2
+#define PREFETCH_AHEAD 4
+#define PREFETCH_JUMP 8
+
+struct cache_block {
+	off_t index;
+	int state;
+	int next;
+	uint64_t used;
+};
+
+static struct cache_block cache[CACHE_BLOCKS];
+static int cache_bucket[CACHE_BUCKETS];
+static uint8_t* cache_data = 0;
+static uint64_t cache_tick = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static off_t prefetch_starts[PREFETCH_AHEAD];
+static int prefetch_count = 0;
+static size_t prefetch_len = 0;
+static size_t prefetch_lo = 0;
+static size_t prefetch_hi = 0;
+static size_t prefetch_row_len = 0;
+static uint64_t prefetch_gen = 0;
+
+//Guess which windows of len Bytes the view moves to next from how it
+//has been moving: PREFETCH_AHEAD windows in the direction of travel,
+//spaced by the last move or a whole window, whichever is further, so
+//both paging and key repeat scrolling stay ahead of the user.  A long
+//jump (Home, End) says nothing about direction, so only the windows
+//either side of the new view are guessed.  Windows are clipped to the
+//file.  Sets *forward if the view is stepping forward through the file.
+static int predict_windows(off_t start, size_t len, off_t* starts, int* forward) {
+	off_t delta = start - predict_offset;
+	off_t step;
+	off_t guess[PREFETCH_AHEAD];
+	int count = 0;
+	int n = 0;
+	int i;
+	
+	if( predict_offset >= 0 && delta != 0 ) {
+		predict_delta = delta;
+	}
+	predict_offset = start;
+	delta = predict_delta;
+	
+	*forward = delta > 0 && delta <= (off_t)len;
+	if( delta == 0 || delta > (off_t)len*PREFETCH_JUMP || delta < -(off_t)len*PREFETCH_JUMP ) {
+		guess[count++] = start + len;
+		guess[count++] = start - len;
+	}
+	else {
+		step = delta < 0 ? -delta : delta;
+		if( step < (off_t)len ) {
+			step = len;
+		}
+		if( delta < 0 ) {
+			step = -step;
+		}
+		for( i=1; i<=PREFETCH_AHEAD; i++ ) {
+			guess[count++] = start + step*i;
+		}
+	}
+	
+	for( i=0; i<count; i++ ) {
+		if( guess[i] + (off_t)len <= 0 || guess[i] >= fd_size ) {
+			continue;
+		}
+		starts[n++] = guess[i] < 0 ? 0 : guess[i];
+	}
+	return n;
+}
+
+//Hint the kernel about the len Bytes at start that are about to be
+//drawn, and the windows the view is expected to move to after that.
+//As for prefetch(), only Bytes lo to hi of each row of row_len Bytes
+//are asked for.  Stepping forward through the file switches the
+//mapping to sequential readahead; any other movement switches it back
+//to random access.
+static void map_advise(off_t start, size_t len, size_t lo, size_t hi, size_t row_len) {
+	long page = sysconf(_SC_PAGESIZE);
+	off_t starts[PREFETCH_AHEAD+1];
+	off_t first, last, done;
+	size_t row;
+	int forward;
+	int advice;
+	int count;
+	int i;
+	
+	count = predict_windows(start,len,starts+1,&forward);
+	starts[0] = start;
+	advice = forward ? MADV_SEQUENTIAL : MADV_RANDOM;
+	if( advice != file_map_advice ) {
+		madvise(file_map,fd_size,advice);
+		file_map_advice = advice;
+	}
+	
+	for( i=0; i<=count; i++ ) {
+		if( lo == 0 && hi == row_len ) {
+			first = starts[i] - starts[i]%page;
+			last = starts[i] + len;
+			if( last > fd_size ) {
+				last = fd_size;
+			}
+			madvise(file_map+first,last-first,MADV_WILLNEED);
+			continue;
+		}
+		//Rows sharing a page ask for it once
+		done = 0;
+		for( row=lo; row<len; row+=row_len ) {
+			first = starts[i] + row;
+			first -= first%page;
+			if( first < done ) {
+				first = done;
+			}
+			last = starts[i] + (row+hi-lo < len ? row+hi-lo : len);
+			if( last > fd_size ) {
+				last = fd_size;
+			}
+			if( first < last ) {
+				madvise(file_map+first,last-first,MADV_WILLNEED);
+				done = last;
+			}
+		}
+	}
+}
+
+//Bytes of cache block index (the last block of the file is short)
+static size_t cache_block_len(off_t index) {
+	off_t start = index*CACHE_BLOCK;
+	
+	return fd_size - start < CACHE_BLOCK ? fd_size - start : CACHE_BLOCK;
+}
+
+static inline int cache_hash(off_t index) {
+	return ((uint64_t)index * 0x9E3779B97F4A7C15ULL) >> 53;
+}
+
+//Cache slot holding block index, or -1.  Called with cache_lock held.
+static int cache_find(off_t index) {
+	int i;
+	
+	for( i=cache_bucket[cache_hash(index)]; i>=0; i=cache[i].next ) {
+		if( cache[i].index == index ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Give slot i block index, or none for -1.  Called with cache_lock held.
+static void cache_assign(int i, off_t index) {
+	int* link;
+	
+	if( cache[i].index >= 0 ) {
+		link = &cache_bucket[cache_hash(cache[i].index)];
+		while( *link != i ) {
+			link = &cache[*link].next;
+		}
+		*link = cache[i].next;
+	}
+	cache[i].index = index;
+	cache[i].next = -1;
+	if( index >= 0 ) {
+		cache[i].next = cache_bucket[cache_hash(index)];
+		cache_bucket[cache_hash(index)] = i;
+	}
+}
+
+//Read up to count missing blocks from index on with a single preadv(),
+//stopping early at a block that is already cached (or being loaded).
+//Slots are taken least recently used first.  Called with cache_lock
+//held; it is dropped for the read itself, and the claimed slots are
+//marked CACHE_LOADING meanwhile so nobody else reads or evicts them.
+//Returns the number of blocks read.
+static int cache_fill(off_t index, int count) {
+	int slots[CACHE_RUN];
+	struct iovec iov[CACHE_RUN];
+	off_t pos = index*CACHE_BLOCK;
+	size_t want = 0;
+	size_t got = 0;
+	ssize_t n;
+	int claimed = 0;
+	int best;
+	int i, j;
+	
+	if( count > CACHE_RUN ) {
+		count = CACHE_RUN;
+	}
+	for( i=0; i<count && (index+i)*CACHE_BLOCK < fd_size; i++ ) {
+		if( cache_find(index+i) >= 0 ) {
+			break;
+		}
+		best = -1;
+		for( j=0; j<CACHE_BLOCKS; j++ ) {
+			if( cache[j].state == CACHE_LOADING ) {
+				continue;
+			}
+			if( best < 0 || cache[j].used < cache[best].used ) {
+				best = j;
+			}
+		}
+		if( best < 0 ) {
+			break;
+		}
+		cache_assign(best,index+i);
+		cache[best].state = CACHE_LOADING;
+		slots[claimed] = best;
+		iov[claimed].iov_base = cache_data + (size_t)best*CACHE_BLOCK;
+		iov[claimed].iov_len = cache_block_len(index+i);
+		want += iov[claimed].iov_len;
+		claimed++;
+	}
+	if( !claimed ) {
+		return 0;
+	}
+	
+	pthread_mutex_unlock(&cache_lock);
+	i = 0;
+	while( got < want ) {
+		n = preadv(fd,iov+i,claimed-i,pos+got);
+		if( n < 0 && errno == EINTR ) {
+			continue;
+		}
+		if( n <= 0 ) {
+			break;
+		}
+		got += n;
+		while( i < claimed && (size_t)n >= iov[i].iov_len ) {
+			n -= iov[i].iov_len;
+			i++;
+		}
+		if( i < claimed ) {
+			iov[i].iov_base = (uint8_t*)iov[i].iov_base + n;
+			iov[i].iov_len -= n;
+		}
+	}
+	pthread_mutex_lock(&cache_lock);
+	
+	//Blocks before i were read completely; drop the rest
+	for( j=0; j<claimed; j++ ) {
+		cache[slots[j]].state = j < i ? CACHE_READY : CACHE_EMPTY;
+		cache[slots[j]].used = ++cache_tick;
+		if( j >= i ) {
+			cache_assign(slots[j],-1);
+		}
+	}
+	pthread_cond_broadcast(&cache_cond);
+	return claimed;
+}
+
+//Copy len Bytes at pos into dst through the block cache, reading
+//whatever the prefetch thread hasn't got to yet.  Less than a block
+//that isn't all cached is read directly instead.
+static void cache_read(uint8_t* dst, size_t len, off_t pos) {
+	off_t index;
+	size_t within, n;
+	int slot;
+	
+	pthread_mutex_lock(&cache_lock);
+	if( len < CACHE_BLOCK &&
+	    ((slot = cache_find(pos/CACHE_BLOCK)) < 0 || cache[slot].state != CACHE_READY ||
+	     (slot = cache_find((pos+len-1)/CACHE_BLOCK)) < 0 || cache[slot].state != CACHE_READY) ) {
+		pthread_mutex_unlock(&cache_lock);
+		errno = 0;
+		if( pread(fd,dst,len,pos) != (ssize_t)len ) {
+			ERROR("File read error: %s\n",strerror(errno));
+		}
+		return;
+	}
+	while( len ) {
+		index = pos/CACHE_BLOCK;
+		within = pos%CACHE_BLOCK;
+		n = CACHE_BLOCK - within;
+		if( n > len ) {
+			n = len;
+		}
+		slot = cache_find(index);
+		if( slot < 0 ) {
+			errno = 0;
+			if( cache_fill(index,(within+len+CACHE_BLOCK-1)/CACHE_BLOCK) == 0 ) {
+				pthread_cond_wait(&cache_cond,&cache_lock);
+				continue;
+			}
+			slot = cache_find(index);
+			if( slot < 0 ) {
+				pthread_mutex_unlock(&cache_lock);
+				ERROR("File read error: %s\n",strerror(errno));
+			}
+		}
+		if( cache[slot].state == CACHE_LOADING ) {
+			pthread_cond_wait(&cache_cond,&cache_lock);
+			continue;
+		}
+		if( within+n > cache_block_len(index) ) {
+			pthread_mutex_unlock(&cache_lock);
+			ERROR("File read error: Unexpected end of file\n");
+		}
+		memcpy(dst,cache_data+(size_t)slot*CACHE_BLOCK+within,n);
+		cache[slot].used = ++cache_tick;
+		dst += n;
+		pos += n;
+		len -= n;
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+//Load the blocks covering len Bytes at pos into the cache, unless a
+//newer prediction comes in or *budget blocks have been used up.
+//Called with cache_lock held.  Returns 0 if prefetching should stop.
+static int cache_prefetch(off_t pos, size_t len, uint64_t gen, int* budget) {
+	off_t index = pos/CACHE_BLOCK;
+	off_t last = (pos+len+CACHE_BLOCK-1)/CACHE_BLOCK;
+	int n;
+	
+	while( index < last ) {
+		if( gen != prefetch_gen || *budget <= 0 ) {
+			return 0;
+		}
+		if( cache_find(index) >= 0 || in_hole(index*CACHE_BLOCK,CACHE_BLOCK) ) {
+			index++;
+			continue;
+		}
+		n = cache_fill(index,last-index < *budget ? last-index : *budget);
+		if( n == 0 ) {
+			return 0;
+		}
+		index += n;
+		*budget -= n;
+	}
+	return 1;
+}
+
+//Prefetch thread: waits for predict_windows() to queue windows, asks
+//the kernel to start reading all of them at once, then pulls them
+//into the cache in order.  Only the columns the read path will ask for
+//are fetched when rows are read partially, and spans narrower than a
+//block, which the read path reads directly, are only advised.
+static void* prefetch_thread(void* arg) {
+	off_t starts[PREFETCH_AHEAD];
+	size_t len, lo, hi, row_len;
+	size_t row;
+	uint64_t gen;
+	int budget;
+	int count;
+	int i;
+	
+	pthread_mutex_lock(&cache_lock);
+	for(;;) {
+		while( !prefetch_count ) {
+			pthread_cond_wait(&prefetch_cond,&cache_lock);
+		}
+		count = prefetch_count;
+		memcpy(starts,prefetch_starts,sizeof(starts));
+		len = prefetch_len;
+		lo = prefetch_lo;
+		hi = prefetch_hi;
+		row_len = prefetch_row_len;
+		gen = prefetch_gen;
+		prefetch_count = 0;
+		
+		pthread_mutex_unlock(&cache_lock);
+		for( i=0; i<count; i++ ) {
+			if( lo == 0 && hi == row_len ) {
+				posix_fadvise(fd,starts[i],len,POSIX_FADV_WILLNEED);
+				continue;
+			}
+			for( row=lo; row<len; row+=row_len ) {
+				posix_fadvise(fd,starts[i]+row,row+hi-lo < len ? hi-lo : len-row,POSIX_FADV_WILLNEED);
+			}
+		}
+		pthread_mutex_lock(&cache_lock);
+		
+		//Leave at least half the cache for what is already loaded
+		budget = CACHE_BLOCKS/2;
+		for( i=0; i<count; i++ ) {
+			if( lo == 0 && hi == row_len ) {
+				if( !cache_prefetch(starts[i],len,gen,&budget) ) {
+					break;
+				}
+				continue;
+			}
+			for( row=lo; row<len && hi-lo >= CACHE_BLOCK; row+=row_len ) {
+				if( !cache_prefetch(starts[i]+row,row+hi-lo < len ? hi-lo : len-row,gen,&budget) ) {
+					goto next;
+				}
+			}
+		}
+	next:
+		;
+	}
+	return arg;
+}
+
+//Set up the block cache and prefetch thread for the read path
+static void cache_setup() {
+	pthread_t thread;
+	int i;
+	
+	errno = 0;
+	cache_data = malloc((size_t)CACHE_BLOCKS*CACHE_BLOCK);
+	if( !cache_data ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	for( i=0; i<CACHE_BLOCKS; i++ ) {
+		cache[i].index = -1;
+		cache[i].next = -1;
+	}
+	for( i=0; i<CACHE_BUCKETS; i++ ) {
+		cache_bucket[i] = -1;
+	}
+	if( (errno = pthread_create(&thread,0,prefetch_thread,0)) ) {
+		ERROR("Thread creation error: %s\n",strerror(errno));
+	}
+	pthread_detach(thread);
+}
+
+//Queue the windows the view is expected to move to next for the
+//prefetch thread, replacing whatever it was still working on.  Bytes
+//lo to hi of each row of row_len Bytes are fetched.
+static void prefetch(off_t start, size_t len, size_t lo, size_t hi, size_t row_len) {
+	off_t starts[PREFETCH_AHEAD];
+	int forward;
+	int count;
+	
+	count = predict_windows(start,len,starts,&forward);
+	pthread_mutex_lock(&cache_lock);
+	memcpy(prefetch_starts,starts,sizeof(starts));
+	prefetch_count = count;
+	prefetch_len = len;
+	prefetch_lo = lo;
+	prefetch_hi = hi;
+	prefetch_row_len = row_len;
+	prefetch_gen++;
+	pthread_cond_signal(&prefetch_cond);
+	pthread_mutex_unlock(&cache_lock);
+}
+
+//Read len Bytes at pos into dst.  Holes are filled with zeros rather
+//than read.
+static void source_read(uint8_t* dst, size_t len, off_t pos) {
+	size_t i = extent_after(pos);
+	size_t n;
+	
+	while( len ) {
+		n = len;
+		if( i < extent_count && extents[i].start > pos ) {
+			if( extents[i].start - pos < (off_t)n ) {
+				n = extents[i].start - pos;
+			}
+		}
+		if( i == extent_count || extents[i].start > pos ) {
+			memset(dst,0,n);
+		}
+		else {
+			if( extents[i].end - pos < (off_t)n ) {
+				n = extents[i].end - pos;
+			}
+			if( cache_data ) {
+				cache_read(dst,n,pos);
+			}
+			else {
+				errno = 0;
+				if( pread(fd,dst,n,pos) != (ssize_t)n ) {
+					ERROR("File read error: %s\n",strerror(errno));
+				}
+			}
+			i++;
+		}
+		dst += n;
+		pos += n;
+		len -= n;
+	}
+}
+
+//Fill read_buffer with the buffer_size Bytes at offset.  Only Bytes lo
+//to hi of each row are read; the rest of the row is left as it was.
+//Reads go through the block cache if there is one, and queue up the
+//windows the view is expected to move to next.
+static void read_view(size_t lo, size_t hi) {
+	size_t row_len = buffer_width/8;
+	size_t stride = row_len;
+	size_t start, len;
+	uint8_t* tmp;
+	
+	if( buffer_size != read_buffer_size ) {
+		errno = 0;
+		tmp = realloc(read_buffer,buffer_size);
+		if( !tmp ) {
+			free(read_buffer);
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+		read_buffer = tmp;
+		read_buffer_size = buffer_size;
+	}
+	buffer = read_buffer;
+	read_lo = lo;
+	read_hi = hi;
+	
+	//Whole rows are one contiguous read
+	len = hi-lo;
+	if( lo == 0 && hi == row_len ) {
+		len = stride = buffer_size;
+	}
+	for( start=lo; start<buffer_size; start+=stride ) {
+		if( start+len > buffer_size ) {
+			len = buffer_size-start;
+		}
+		source_read(read_buffer+start,len,offset+start);
+	}
+	if( cache_data ) {
+		prefetch(offset,buffer_size,lo,hi,row_len);
+	}
+}
+
+//Zoomed out views.  Each pixel stands for 2^zoom_shift bits of the
+//file, and is set if any of them are (ZOOM_ANY), over half of them
+//(ZOOM_MAJORITY) or at least zoom_threshold percent (ZOOM_DENSITY).
+#define ZOOM_ANY 0
+#define ZOOM_MAJORITY 1
+#define ZOOM_DENSITY 2
+#define ZOOM_MAX 40
+#define ZOOM_SPARSE 15
+#define ZOOM_CHUNK (1024*1024)
+//Counting looks for a key press every ZOOM_POLL Bytes, and says so once
+//it has counted ZOOM_SLOW for a view
+#define ZOOM_POLL (16*1024*1024)
+#define ZOOM_SLOW (256*1024*1024)
+
+static const char* zoom_names[] = {"any","majority","density"};
+static uint8_t* zoom_buffer = 0;
+static size_t zoom_buffer_size = 0;
+static uint8_t* zoom_chunk = 0;
+static uint64_t zoom_counted = 0;
+static int zoom_stopped = 0;
+
+static inline int zoom_pixel(uint64_t count, uint64_t bits) {
+	switch( zoom_mode ) {
+	case ZOOM_MAJORITY:
+		return count*2 > bits;
+	case ZOOM_DENSITY:
+		return count && count*100 >= (uint64_t)zoom_threshold*bits;
+	default:
+		return count != 0;
+	}
+}
+
+//Set bits in the len Bytes at pos, up to the end of the file.  Only the
+//data extents are read, a chunk at a time, with the next chunk of a
+//mapped file read ahead.  A key press sets zoom_stopped and leaves the
+//count short.
+static uint64_t zoom_count(off_t pos, uint64_t len) {
+	long page = sysconf(_SC_PAGESIZE);
+	off_t end = pos + len;
+	off_t start, stop, ahead;
+	uint64_t count = 0;
+	size_t i, n;
+	
+	if( end > fd_size ) {
+		end = fd_size;
+	}
+	for( i=extent_after(pos); i<extent_count && extents[i].start < end; i++ ) {
+		start = extents[i].start > pos ? extents[i].start : pos;
+		stop = extents[i].end < end ? extents[i].end : end;
+		while( start < stop ) {
+			n = stop-start < ZOOM_CHUNK ? stop-start : ZOOM_CHUNK;
+			if( file_map ) {
+				ahead = start+n - (start+n)%page;
+				if( ahead < stop ) {
+					madvise(file_map+ahead,stop-ahead < ZOOM_CHUNK ? stop-ahead : ZOOM_CHUNK,MADV_WILLNEED);
+				}
+				count += popcount_bytes(file_map+start,n);
+			}
+			else {
+				errno = 0;
+				if( pread(fd,zoom_chunk,n,start) != (ssize_t)n ) {
+					ERROR("File read error: %s\n",strerror(errno));
+				}
+				count += popcount_bytes(zoom_chunk,n);
+			}
+			start += n;
+			zoom_counted += n;
+			if( zoom_counted % ZOOM_POLL < n ) {
+				if( key_waiting() ) {
+					zoom_stopped = 1;
+					return count;
+				}
+				if( zoom_counted / ZOOM_POLL == ZOOM_SLOW / ZOOM_POLL ) {
+					show_status("Counting set bits... (any key stops it)");
+				}
+			}
+		}
+	}
+	return count;
+}
+
+//Set bits in the len Bytes at pos, as zoom_count(), but with the whole
+//PYRAMID_BLOCKs in them added up from the pyramid's counts, if the
+//first done blocks it has counted take them in
+static uint64_t zoom_sum(off_t pos, uint64_t len, size_t done) {
+	off_t end = pos + (off_t)len < fd_size ? pos + (off_t)len : fd_size;
+	size_t first = (pos+PYRAMID_BLOCK-1)/PYRAMID_BLOCK;
+	size_t last = end/PYRAMID_BLOCK;
+	uint64_t count = 0;
+	size_t i;
+	
+	if( !pyramid_bits || first >= last || last > done ) {
+		return zoom_count(pos,len);
+	}
+	for( i=first; i<last; i++ ) {
+		count += pyramid_bits[i];
+	}
+	return count + zoom_count(pos,(off_t)first*PYRAMID_BLOCK-pos) + zoom_count((off_t)last*PYRAMID_BLOCK,end-(off_t)last*PYRAMID_BLOCK);
+}
+
+//Pixels of Bytes lo to hi of the view's row at pos, ORed into out.
+//Small pixels are counted from a chunk of the file read in one go, no
+//more than the row needs; pixels of 2^ZOOM_SPARSE bits or more one at
+//a time, skipping holes, from the pyramid as far as done.  It stops
+//short if a key is pressed.
+static void zoom_row(uint8_t* out, off_t pos, size_t lo, size_t hi, size_t done) {
+	int k = zoom_shift;
+	uint64_t bits = (uint64_t)1 << k;
+	size_t piece = k < ZOOM_SPARSE ? (size_t)ZOOM_CHUNK*8 >> k : 1;
+	off_t start, span;
+	off_t avail = 0;
+	const uint8_t* src = 0;
+	uint64_t b, n, count;
+	size_t x, first = 0;
+	
+	for( x=lo*8; x<hi*8; x++ ) {
+		start = pos + ((off_t)x << k >> 3);
+		if( start >= fd_size ) {
+			break;
+		}
+		if( k >= ZOOM_SPARSE ) {
+			n = fd_size-start < (off_t)(bits/8) ? (uint64_t)(fd_size-start)*8 : bits;
+			count = zoom_sum(start,bits/8,done);
+			if( zoom_stopped ) {
+				break;
+			}
+		}
+		else {
+			if( (x-lo*8) % piece == 0 ) {
+				avail = fd_size-start < ZOOM_CHUNK ? fd_size-start : ZOOM_CHUNK;
+				span = (((off_t)(hi*8-x) << k) + 7) >> 3;
+				if( avail > span ) {
+					avail = span;
+				}
+				if( file_map ) {
+					src = file_map + start;
+				}
+				else {
+					source_read(zoom_chunk,avail,start);
+					src = zoom_chunk;
+				}
+				first = x;
+			}
+			b = (uint64_t)(x-first) << k;
+			if( b >= (uint64_t)avail*8 ) {
+				break;
+			}
+			n = (uint64_t)avail*8-b < bits ? (uint64_t)avail*8-b : bits;
+			if( k < 3 ) {
+				//The pixel's bits, in the order they are shown
+				count = __builtin_popcount((src[b/8] >> (reverse_byte ? b%8 : 8-b%8-bits)) & ((1<<bits)-1));
+			}
+			else {
+				count = popcount_bytes(src+b/8,n/8);
+			}
+		}
+		if( zoom_pixel(count,n) ) {
+			out[x/8] |= reverse_byte ? 1<<(x%8) : 0x80>>(x%8);
+		}
+	}
+}
+
+//What zoom_buffer last showed.  Scrolling by whole rows keeps the rows
+//still in view, and only the new ones are counted.
+static off_t zoom_offset = -1;
+static int zoom_last_shift, zoom_last_mode, zoom_last_threshold;
+static size_t zoom_lo, zoom_hi, zoom_row_len, zoom_size;
+
+//Fill zoom_buffer with the buffer_size Bytes of pixels of the view at
+//offset, zoomed out by zoom_shift, and show it.  Only Bytes lo to hi of
+//each row are made.  Pixels big enough for the pyramid start it being
+//built.  A key press leaves the rest of the view blank, with
+//zoom_stopped set.
+static void zoom_view(size_t lo, size_t hi) {
+	size_t row_len = buffer_width/8;
+	size_t rows = (buffer_size + row_len-1)/row_len;
+	off_t row_bytes = (off_t)row_len << zoom_shift;
+	off_t moved = rows;
+	size_t y, y0 = 0, y1 = rows;
+	size_t done = 0;
+	uint8_t* tmp;
+	
+	if( rows*row_len != zoom_buffer_size ) {
+		errno = 0;
+		tmp = realloc(zoom_buffer,rows*row_len);
+		if( !tmp ) {
+			free(zoom_buffer);
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+		zoom_buffer = tmp;
+		zoom_buffer_size = rows*row_len;
+		zoom_offset = -1;
+	}
+	if( !zoom_chunk ) {
+		errno = 0;
+		zoom_chunk = malloc(ZOOM_CHUNK);
+		if( !zoom_chunk ) {
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+	}
+	buffer = zoom_buffer;
+	read_lo = lo;
+	read_hi = hi;
+	zoom_counted = 0;
+	zoom_stopped = 0;
+	if( zoom_shift >= ZOOM_SPARSE ) {
+		pyramid_setup();
+		pthread_mutex_lock(&pyramid_lock);
+		done = pyramid_done;
+		pthread_mutex_unlock(&pyramid_lock);
+	}
+	
+	if( zoom_offset >= 0 && zoom_last_shift == zoom_shift && zoom_last_mode == zoom_mode &&
+	    zoom_last_threshold == zoom_threshold && zoom_lo == lo && zoom_hi == hi &&
+	    zoom_row_len == row_len && zoom_size == buffer_size && (offset - zoom_offset) % row_bytes == 0 ) {
+		moved = (offset - zoom_offset) / row_bytes;
+	}
+	if( moved > 0 && moved < (off_t)rows ) {
+		memmove(zoom_buffer,zoom_buffer + moved*row_len,(rows-moved)*row_len);
+		y0 = rows-moved;
+	}
+	else if( moved <= 0 && -moved < (off_t)rows ) {
+		memmove(zoom_buffer - moved*row_len,zoom_buffer,(rows+moved)*row_len);
+		y1 = -moved;
+	}
+	memset(zoom_buffer + y0*row_len,0,(y1-y0)*row_len);
+	for( y=y0; y<y1 && !zoom_stopped; y++ ) {
+		zoom_row(zoom_buffer + y*row_len,offset + (off_t)y*row_bytes,lo,hi,done);
+	}
+	
+	//Rows not counted can't be kept
+	zoom_offset = zoom_stopped ? -1 : offset;
+	zoom_last_shift = zoom_shift;
+	zoom_last_mode = zoom_mode;
+	zoom_last_threshold = zoom_threshold;
+	zoom_lo = lo;
+	zoom_hi = hi;
+	zoom_row_len = row_len;
+	zoom_size = buffer_size;
+}
+
+//Elementary cellular automata.  A row of cells is the state, and the
+//next generation is the row below: cell x lives if bit (west<<2 |
+//cell<<1 | east) of wolfram_rule is set, west and east being cells x-1
+//and x+1.  The rule is a tree of muxes on the three cells, as for Life,
+//whose leaves are the bits of the rule.
+#define WOLFRAM_LEAF(n) ((uint64_t)-(int64_t)((rule >> (n)) & 1))
+
+static inline uint64_t wolfram_cells(uint64_t w, uint64_t c, uint64_t e, const int rule) {
+	return life_mux(w,
+		life_mux(c,life_mux(e,WOLFRAM_LEAF(0),WOLFRAM_LEAF(1)),life_mux(e,WOLFRAM_LEAF(2),WOLFRAM_LEAF(3))),
+		life_mux(c,life_mux(e,WOLFRAM_LEAF(4),WOLFRAM_LEAF(5)),life_mux(e,WOLFRAM_LEAF(6),WOLFRAM_LEAF(7))));
+}
+
+static inline void wolfram_kernel(uint8_t* out, const uint8_t* src, size_t words, const int reverse, const int rule) {
+	uint64_t c;
+	size_t off;
+	size_t i;
+	
+	for( i=0; i<words; i++ ) {
+		off = i*8;
+		c = life_load(src+off);
+		c = wolfram_cells(life_west(src+off,c,reverse),c,life_east(src+off,c,reverse),rule);
+		memcpy(out+off,&c,8);
+	}
+}
+
+//Rules 30 and 110, the usual ones for whitening, get instances of their
+//own with the rule built in
+#define WOLFRAM_INSTANCE(r) { \
+	if( reverse ) { \
+		wolfram_kernel(out,src,words,1,r); \
+	} \
+	else { \
+		wolfram_kernel(out,src,words,0,r); \
+	} \
+}
+
+static void wolfram_row_step(uint8_t* out, const uint8_t* src, size_t words, int reverse) {
+	if( wolfram_rule == 30 ) {
+		WOLFRAM_INSTANCE(30);
+	}
+	else if( wolfram_rule == 110 ) {
+		WOLFRAM_INSTANCE(110);
+	}
+	else {
+		WOLFRAM_INSTANCE(wolfram_rule);
+	}
+}
+
+//Make room for rows generations, keeping as many of the latest as fit
+static void wolfram_resize(size_t rows) {
+	size_t row_len = buffer_width/8;
+	uint8_t* old = wolfram_ring;
+	size_t old_rows = wolfram_rows;
+	uint64_t keep = wolfram_generation+1;
+	uint64_t y;
+	
+	errno = 0;
+	wolfram_ring = calloc(2*rows,wolfram_stride);
+	if( !wolfram_ring ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	wolfram_rows = rows;
+	if( keep > old_rows ) {
+		keep = old_rows;
+	}
+	if( keep > rows ) {
+		keep = rows;
+	}
+	if( old ) {
+		for( y=wolfram_generation+1-keep; y<=wolfram_generation && keep; y++ ) {
+			memcpy(wolfram_row(y),old + (y % old_rows)*wolfram_stride + LIFE_PAD,row_len);
+			memcpy(wolfram_row(y)+rows*wolfram_stride,wolfram_row(y),row_len);
+		}
+		free(old);
+	}
+}
+
+//Start a waterfall from the top row of the view, with room for rows
+//generations.  Zoomed out, the row is the pixels shown, across the
+//whole width whichever columns are in view.
+static void wolfram_setup(size_t rows) {
+	size_t row_len = buffer_width/8;
+	size_t len = row_len < buffer_size ? row_len : buffer_size;
+	uint8_t* row;
+	
+	if( !row_len ) {
+		return;
+	}
+	wolfram_stride = LIFE_PAD + (row_len+7)/8*8 + LIFE_PAD;
+	wolfram_generation = 0;
+	wolfram_rows = 0;
+	wolfram_resize(rows);
+	row = wolfram_row(0);
+	if( view_zoom ) {
+		zoom_row(row,offset,0,row_len,0);
+	}
+	else if( life_state || file_map ) {
+		memcpy(row,buffer,len);
+	}
+	else if( !in_hole(offset,len) ) {
+		source_read(row,len,offset);
+	}
+	memcpy(row+rows*wolfram_stride,row,row_len);
+}
+
+//Stop the waterfall.  The view has to be read again.
+static void wolfram_free() {
+	free(wolfram_ring);
+	wolfram_ring = 0;
+	wolfram_rows = 0;
+	buffer_offset = -1;
+}
+
+//Add n generations to the bottom of the waterfall.  -T decides whether
+//the ends of the row wrap round or have dead cells beyond them.
+static void wolfram_step(int n) {
+	size_t row_len = buffer_width/8;
+	size_t words = (row_len+7)/8;
+	uint8_t* src;
+	uint8_t* out;
+	
+	for( ; n>0; n-- ) {
+		src = wolfram_row(wolfram_generation);
+		out = wolfram_row(wolfram_generation+1);
+		if( life_topology != LIFE_PLANE ) {
+			src[-1] = src[row_len-1];
+			src[row_len] = src[0];
+		}
+		wolfram_row_step(out,src,words,reverse_byte);
+		memset(out+row_len,0,words*8-row_len);
+		memcpy(out+wolfram_rows*wolfram_stride,out,row_len);
+		wolfram_generation++;
+	}
+}
+
+static void update() {
+	int term_w, term_h;
+	int char_y;
+	int disp_w;
+	int rows_h;
+	int i;
+	size_t new_buffer_size;
+	size_t row_start;
+	size_t row_len;
+	size_t stride;
+	size_t life_y;
+	uint64_t top = 0;
+	off_t view_offset;
+	int evolved;
+	size_t need_lo, need_hi;
+	size_t view_lo, view_hi;
+	size_t margin;
+	off_t zoom_size;
+	off_t row_bytes;
+	const uint8_t* rows[4];
+	size_t lens[4];
+	
+	term_size(&term_w,&term_h);
+	//If left unset, set buffer_width the maximum displayable
+	//number of bits
+	if( !buffer_width ) {
+		buffer_width = term_w*glyph_w;
+	}
+	if( buffer_width % 8 ) {
+		buffer_width = buffer_width - (buffer_width % 8);
+	}
+	
+	if( col_offset + term_w*glyph_w > buffer_width ) {
+		col_offset = buffer_width - term_w*glyph_w;
+	}
+	if( col_offset < 0 ) {
+		col_offset = 0;
+	}
+	
+	//Bytes of each row that are on screen.  If rows are much wider
+	//than that, the read path only reads those columns plus a screen
+	//width on either side.
+	row_len = buffer_width/8;
+	need_lo = col_offset/8;
+	need_hi = (col_offset + term_w*glyph_w + 7)/8;
+	if( need_hi > row_len ) {
+		need_hi = row_len;
+	}
+	
+	//Zoom only applies to the file
+	view_zoom = life_state || wolfram_ring ? 0 : zoom_shift;
+	if( wolfram_ring ) {
+		//The waterfall stands in for the file, its latest generation at
+		//the bottom.  It moves a whole text row at a time, so the
+		//terminal can scroll it.
+		if( (size_t)term_h*glyph_h > wolfram_rows ) {
+			wolfram_resize(term_h*glyph_h);
+		}
+		rows_h = term_h - (hole_map ? 1 : 0) - 1;
+		if( rows_h > 0 && wolfram_generation+1 > (uint64_t)rows_h*glyph_h ) {
+			top = (wolfram_generation+1 - (uint64_t)rows_h*glyph_h + glyph_h-1)/glyph_h*glyph_h;
+		}
+		buffer = wolfram_row(top);
+		buffer_size = (wolfram_generation+1 - top)*row_len;
+	}
+	else if( life_state ) {
+		//Life's world stands in for the file.  The view starts on one of
+		//its rows and takes in the partial last row at the end.
+		buffer_size = (size_t)term_h*glyph_h*row_len < life_size ? (size_t)term_h*glyph_h*row_len : life_size;
+		if( offset > life_origin + (off_t)(life_size - buffer_size) ) {
+			offset = life_origin + life_size - buffer_size + row_len-1;
+		}
+		if( offset < life_origin ) {
+			offset = life_origin;
+		}
+		offset -= (offset - life_origin) % row_len;
+		life_y = (offset - life_origin)/row_len;
+		if( buffer_size > life_size - life_y*row_len ) {
+			buffer_size = life_size - life_y*row_len;
+		}
+		buffer = life_row(life_state,life_y);
+		last_term_h = term_h;
+		last_term_w = term_w;
+		buffer_offset = offset;
+	}
+	else if( term_h != last_term_h || 
+	         term_w != last_term_w || 
+	         buffer_offset != offset ||
+	         need_lo < read_lo || need_hi > read_hi ) {
+		//Determine (based on current terminal size)
+		//how many Bytes of data can be displayed and resize
+		//buffer to accept them
+		new_buffer_size = (term_h*glyph_h) * buffer_width;
+		if( new_buffer_size % 8 ) {
+			new_buffer_size = new_buffer_size/8+1;
+		}
+		else {
+			new_buffer_size = new_buffer_size/8;
+		}
+		//Zoomed out, each Byte of the view covers 2^view_zoom of the file
+		zoom_size = (fd_size + ((off_t)1 << view_zoom) - 1) >> view_zoom;
+		if( new_buffer_size > zoom_size ) {
+			new_buffer_size = zoom_size;
+		}
+		buffer_size = new_buffer_size;
+		
+		if( offset + ((off_t)buffer_size << view_zoom) > fd_size ) {
+			offset = fd_size - ((off_t)buffer_size << view_zoom);
+		}
+		if( offset < 0 ) {
+			offset = 0;
+		}
+		view_lo = 0;
+		view_hi = row_len;
+		if( row_len > 4*(need_hi-need_lo) ) {
+			margin = need_hi - need_lo;
+			view_lo = need_lo > margin ? need_lo-margin : 0;
+			view_hi = need_hi+margin < row_len ? need_hi+margin : row_len;
+		}
+		if( file_map && !view_zoom ) {
+			//Render straight from the mapping, which only faults in the
+			//columns drawn, but is advised of the window around them
+			map_advise(offset,buffer_size,view_lo,view_hi,row_len);
+			buffer = file_map + offset;
+			read_lo = view_lo;
+			read_hi = view_hi;
+		}
+		else {
+			if( view_zoom ) {
+				zoom_view(view_lo,view_hi);
+			}
+			else {
+				read_view(view_lo,view_hi);
+			}
+		}
+
+		last_term_h = term_h;
+		last_term_w = term_w;
+		//A count stopped by a key is taken up again next time
+		buffer_offset = view_zoom && zoom_stopped ? -1 : offset;
+	}
+	
+	disp_w = buffer_width/glyph_w;
+	//The minimap takes the last column, when it is drawn
+	if( disp_w > term_w - (minimap && !wolfram_ring ? 1 : 0) ) {
+		disp_w = term_w - (minimap && !wolfram_ring ? 1 : 0);
+	}
+	
+	frame_setup(term_w,term_h);
+	//Life's grid and the waterfall have padded rows and no longer match
+	//the file
+	evolved = life_state || wolfram_ring;
+	//The hole map takes the bottom row, and Life's status the one above
+	rows_h = term_h - (hole_map ? 1 : 0) - (evolved ? 1 : 0);
+	if( rows_h < 0 ) {
+		rows_h = 0;
+	}
+	//A move by whole text rows can be scrolled by the terminal
+	row_bytes = (off_t)(buffer_width/8*glyph_h) << view_zoom;
+	view_offset = wolfram_ring ? (off_t)(top*row_len) : offset;
+	if( col_offset == frame_col_offset && view_zoom == frame_zoom && view_offset != frame_offset &&
+	    (view_offset - frame_offset) % row_bytes == 0 ) {
+		frame_scroll((view_offset - frame_offset)/row_bytes,rows_h);
+	}
+	frame_offset = view_offset;
+	frame_col_offset = col_offset;
+	frame_zoom = view_zoom;
+	memset(frame,0,term_w*term_h);
+	stride = wolfram_ring ? wolfram_stride : evolved ? life_stride : row_len;
+	for( char_y=0; char_y<rows_h; char_y++ ) {
+		for( i=0; i<glyph_h; i++ ) {
+			row_start = (size_t)(char_y*glyph_h+i)*row_len;
+			rows[i] = buffer + (size_t)(char_y*glyph_h+i)*stride;
+			lens[i] = 0;
+			if( row_start < buffer_size ) {
+				lens[i] = buffer_size - row_start;
+				if( lens[i] > buffer_width/8 ) {
+					lens[i] = buffer_width/8;
+				}
+				//Rows in holes are zero without touching them
+				if( !evolved && !view_zoom && in_hole(offset+row_start,lens[i]) ) {
+					lens[i] = 0;
+				}
+			}
+		}
+		glyph_row(frame+char_y*term_w,rows,lens,col_offset,disp_w);
+	}
+	frame_draw(rows_h);
+	minimap_rows = rows_h;
+	if( minimap && !wolfram_ring ) {
+		draw_minimap(term_w-1,rows_h);
+	}
+	if( evolved && rows_h < term_h ) {
+		draw_life_status(term_w,rows_h);
+	}
+	if( hole_map ) {
+		draw_hole_map(term_w,term_h-1);
+	}
+	out_flush();
+}
+
+//Large grids are stepped in horizontal bands by a pool of threads, one
+//per CPU with the main thread taking the first band.  Each band reads
+//the rows either side of it (its halo) straight from the current
+//generation, which nobody writes until every band is done.
+#define LIFE_BAND_MIN (64*1024)
+
+//The grid is also cut into tiles of 64 rows by 64 bytes, and a tile is
+//only stepped when something near it changed.  The buffer a generation
+//is written to holds the one two back, so a tile whose surroundings
+//match that generation would come out as the buffer already has it.
+//Comparing against it rather than the last generation lets blinkers
+//and other period 2 debris rest as well as still lifes.
+#define LIFE_TILE_RUN 16
+
+static int life_threads = 0;
+static pthread_barrier_t life_start;
+static pthread_barrier_t life_done;
+static size_t life_job_rows = 0;
+static size_t life_job_words = 0;
+static size_t life_job_row_len = 0;
+//What lies below the last row stepped: the padding or partial row
+//after it, or the wrap row
+static uint8_t* life_job_bottom = 0;
+static int life_job_bands = 0;
+static size_t life_tiles_x = 0;
+static size_t life_tiles_y = 0;
+static uint8_t* life_active = 0;
+static uint8_t* life_changed = 0;
+static struct life_census* life_state_census = 0;
+static struct life_census* life_buffer_census = 0;
+
+static void life_band(int band) {
+	uint8_t out[LIFE_TILE_RUN*LIFE_TILE_BYTES] __attribute__((aligned(64)));
+	struct life_census* tile;
+	size_t ty = life_tiles_y*band/life_job_bands;
+	size_t end = life_tiles_y*(band+1)/life_job_bands;
+	uint8_t* active;
+	uint8_t* dst;
+	size_t tx, run, x, y, y0, y1, i, len, cmp;
+	
+	for( ; ty<end; ty++ ) {
+		active = life_active + ty*life_tiles_x;
+		y0 = ty*LIFE_TILE_ROWS;
+		y1 = y0+LIFE_TILE_ROWS < life_job_rows ? y0+LIFE_TILE_ROWS : life_job_rows;
+		for( tx=0; tx<life_tiles_x; tx=run ) {
+			//Runs of active tiles go to the kernel in one call
+			for( run=tx; run<life_tiles_x && run-tx<LIFE_TILE_RUN && active[run]; run++ );
+			if( run == tx ) {
+				run++;
+				continue;
+			}
+			x = tx*LIFE_TILE_BYTES;
+			len = (run-tx)*LIFE_TILE_BYTES;
+			for( y=y0; y<y1; y++ ) {
+				life_row_step(out,life_row(life_state,y)-life_stride+x,life_row(life_state,y)+x,
+				              (y+1 < life_job_rows ? life_row(life_state,y+1) : life_job_bottom)+x,len/8,reverse_byte);
+				//Births past the right edge would feed back in next time
+				if( x+len > life_job_row_len ) {
+					memset(out+life_job_row_len-x,0,x+len-life_job_row_len);
+				}
+				dst = life_row(life_buffer,y)+x;
+				for( i=0; i<len; i+=LIFE_TILE_BYTES ) {
+					cmp = life_job_row_len-x-i < LIFE_TILE_BYTES ? life_job_row_len-x-i : LIFE_TILE_BYTES;
+					if( memcmp(dst+i,out+i,cmp) ) {
+						memcpy(dst+i,out+i,LIFE_TILE_BYTES);
+						life_changed[ty*life_tiles_x+tx+i/LIFE_TILE_BYTES] = 1;
+					}
+				}
+			}
+			//The tiles just stepped are all in life_buffer now
+			for( ; tx<run; tx++ ) {
+				tile = &life_buffer_census[ty*life_tiles_x+tx];
+				x = tx*LIFE_TILE_BYTES;
+				memset(tile,0,sizeof(*tile));
+				life_census_tile(tile,life_row(life_buffer,y0)+x,life_row(life_state,y0)+x,y1-y0,life_stride,y0*life_stride+x);
+				tile->deaths = tile->births + life_state_census[ty*life_tiles_x+tx].population - tile->population;
+			}
+		}
+	}
+}
+
+//What the pool's threads run: life_band(), or the timing job of
+//life_tune()
+static void (*life_job)(int band) = life_band;
+
+static void* life_worker(void* arg) {
+	int band = (int)(intptr_t)arg;
+	
+	for(;;) {
+		pthread_barrier_wait(&life_start);
+		if( band < life_job_bands ) {
+			life_job(band);
+		}
+		pthread_barrier_wait(&life_done);
+	}
+	return 0;
+}
+
+static void life_pool_setup() {
+	pthread_t thread;
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+	
+	life_threads = n > 1 ? n : 1;
+	if( life_threads == 1 ) {
+		return;
+	}
+	pthread_barrier_init(&life_start,0,life_threads);
+	pthread_barrier_init(&life_done,0,life_threads);
+	for( i=1; i<life_threads; i++ ) {
+		if( (errno = pthread_create(&thread,0,life_worker,(void*)(intptr_t)i)) ) {
+			ERROR("Thread creation error: %s\n",strerror(errno));
+		}
+		pthread_detach(thread);
+	}
+}
+
+//life_tune() times each kernel stepping the first LIFE_TUNE_BYTES of
+//the world into scratch, best of LIFE_TUNE_RUNS, the way life_band()
+//feeds it.  The world's width is what decides between them, and the
+//sample is big enough for the pool to split.  The widest go first, so
+//one that couldn't win even with every thread on it (the reference)
+//is only run once.
+#define LIFE_TUNE_BYTES (1024*1024)
+#define LIFE_TUNE_RUNS 2
+
+static size_t life_tune_rows = 0;
+
+static void life_band_tune(int band) {
+	uint8_t out[LIFE_TILE_RUN*LIFE_TILE_BYTES] __attribute__((aligned(64)));
+	size_t y = life_tune_rows*band/life_job_bands;
+	size_t end = life_tune_rows*(band+1)/life_job_bands;
+	size_t x, len;
+	
+	for( ; y<end; y++ ) {
+		for( x=0; x<life_job_words*8; x+=len ) {
+			len = life_job_words*8-x < sizeof(out) ? life_job_words*8-x : sizeof(out);
+			life_row_step(out,life_row(life_state,y)-life_stride+x,life_row(life_state,y)+x,life_row(life_state,y+1)+x,len/8,reverse_byte);
+		}
+	}
+}
+
+static void life_tune() {
+	size_t row_len = buffer_width/8;
+	size_t h = life_size/row_len;
+	struct timespec t0, t1;
+	uint64_t ns, best = 0;
+	int k, threaded, run;
+	
+	if( !life_state || !h ) {
+		return;
+	}
+	if( !life_threads ) {
+		life_pool_setup();
+	}
+	life_tune_rows = LIFE_TUNE_BYTES/row_len;
+	if( life_tune_rows < 1 ) {
+		life_tune_rows = 1;
+	}
+	if( life_tune_rows > h ) {
+		life_tune_rows = h;
+	}
+	life_job_words = (row_len+LIFE_ROW_ALIGN-1)/LIFE_ROW_ALIGN*(LIFE_ROW_ALIGN/8);
+	life_job = life_band_tune;
+	for( k=life_kernel_count-1; k>=0; k-- ) {
+		life_row_step = life_kernels[k].fn;
+		life_kernels[k].ns[1] = 0;
+		for( threaded=0; threaded<=(life_threads > 1); threaded++ ) {
+			life_job_bands = threaded ? life_threads : 1;
+			for( run=0; run<LIFE_TUNE_RUNS; run++ ) {
+				clock_gettime(CLOCK_MONOTONIC,&t0);
+				if( threaded ) {
+					pthread_barrier_wait(&life_start);
+					life_band_tune(0);
+					pthread_barrier_wait(&life_done);
+				}
+				else {
+					life_band_tune(0);
+				}
+				clock_gettime(CLOCK_MONOTONIC,&t1);
+				ns = (t1.tv_sec-t0.tv_sec)*1000000000ull + t1.tv_nsec - t0.tv_nsec;
+				if( !run || ns < life_kernels[k].ns[threaded] ) {
+					life_kernels[k].ns[threaded] = ns;
+				}
+				if( best && ns > best*life_threads ) {
+					break;
+				}
+			}
+			if( !best || life_kernels[k].ns[threaded] < best ) {
+				best = life_kernels[k].ns[threaded];
+				life_kernel_pick = k;
+				life_kernel_threaded = threaded;
+			}
+			if( life_kernels[k].ns[threaded] > best*life_threads ) {
+				break;
+			}
+		}
+	}
+	life_row_step = life_kernels[life_kernel_pick].fn;
+	life_job = life_band;
+}
+
+//Hashes of the last LIFE_HISTORY generations, by generation modulo
+//LIFE_HISTORY.  A repeat means Life has settled into a cycle.
+#define LIFE_HISTORY 256
+
+static uint64_t life_history[LIFE_HISTORY];
+static size_t life_history_len = 0;
+
+//Total up the census of the tiles, and look for the current generation
+//among the ones before it.  Each grid keeps the census of its tiles, so
+//one that wasn't stepped still has its census from two generations ago,
+//when its births and deaths were the last generation's deaths and
+//births the other way round.
+static void life_count() {
+	struct life_census* tile;
+	uint64_t hash = 0;
+	size_t i;
+	
+	life_population = 0;
+	life_births = 0;
+	life_deaths = 0;
+	for( i=0; i<life_tiles_x*life_tiles_y; i++ ) {
+		tile = &life_state_census[i];
+		if( !life_active[i] ) {
+			tile->births = life_buffer_census[i].deaths;
+			tile->deaths = life_buffer_census[i].births;
+		}
+		hash += tile->hash;
+		life_population += tile->population;
+		life_births += tile->births;
+		life_deaths += tile->deaths;
+	}
+	life_period = 0;
+	for( i=1; i<=life_history_len; i++ ) {
+		if( life_history[(life_generation-i)%LIFE_HISTORY] == hash ) {
+			life_period = i;
+			break;
+		}
+	}
+	life_history[life_generation%LIFE_HISTORY] = hash;
+	if( life_history_len < LIFE_HISTORY ) {
+		life_history_len++;
+	}
+}
+
+//Start tile tracking over from the grid in life_state, as if it had
+//been there for ever: every tile gets stepped once, and compared with
+//a copy of itself in place of the generation before, which the caller
+//must have put in life_buffer.  The census and the history of hashes
+//start again too.
+static void life_restart() {
+	size_t h = life_size/(buffer_width/8);
+	size_t tx, ty, x, y0, y1;
+	
+	memset(life_changed,1,life_tiles_x*life_tiles_y);
+	memset(life_state_census,0,life_tiles_x*life_tiles_y*sizeof(struct life_census));
+	for( ty=0; ty<life_tiles_y; ty++ ) {
+		y0 = ty*LIFE_TILE_ROWS;
+		y1 = y0+LIFE_TILE_ROWS < h ? y0+LIFE_TILE_ROWS : h;
+		for( tx=0; tx<life_tiles_x && y0<y1; tx++ ) {
+			x = tx*LIFE_TILE_BYTES;
+			life_census_tile(&life_state_census[ty*life_tiles_x+tx],life_row(life_state,y0)+x,life_row(life_state,y0)+x,y1-y0,life_stride,y0*life_stride+x);
+		}
+	}
+	memcpy(life_buffer_census,life_state_census,life_tiles_x*life_tiles_y*sizeof(struct life_census));
+	memset(life_active,1,life_tiles_x*life_tiles_y);
+	life_history_len = 0;
+	life_count();
+}
+
+//A grid for Life's world.  Small ones live in memory; bigger ones are
+//mapped from a scratch file, so the kernel can page out whatever isn't
+//being stepped and a world bigger than RAM still fits.  Either way it
+//starts out zero.
+#define LIFE_RAM_MAX (128*1024*1024)
+
+static uint8_t* life_map(size_t size) {
+	char path[4096];
+	const char* dir = getenv("TMPDIR");
+	int scratch;
+	void* map;
+	
+	errno = 0;
+	if( size <= LIFE_RAM_MAX ) {
+		map = mmap(0,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	}
+	else {
+		snprintf(path,sizeof(path),"%s/bitraster.XXXXXX",dir ? dir : "/var/tmp");
+		if( (scratch = mkstemp(path)) < 0 ) {
+			ERROR("Scratch file error: %s: %s\n",path,strerror(errno));
+		}
+		unlink(path);
+		if( ftruncate(scratch,size) ) {
+			ERROR("Scratch file error: %s\n",strerror(errno));
+		}
+		map = mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED,scratch,0);
+		close(scratch);
+	}
+	if( map == MAP_FAILED ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	return map;
+}
+
+//Go back to showing the file
+static void life_free() {
+	if( life_state ) {
+		munmap(life_state,life_grid_size);
+		munmap(life_buffer,life_grid_size);
+	}
+	life_state = 0;
+	life_buffer = 0;
+}
+
+//Grids for a world of size Bytes of the file from origin, and the
+//tile tracking to go with them
+static void life_alloc(off_t origin, size_t size) {
+	size_t row_len = buffer_width/8;
+	size_t words = (row_len+LIFE_ROW_ALIGN-1)/LIFE_ROW_ALIGN*(LIFE_ROW_ALIGN/8);
+	size_t rows;
+	uint8_t* tmp[5];
+	
+	life_origin = origin;
+	life_size = size;
+	rows = (life_size+row_len-1)/row_len;
+	life_stride = LIFE_PAD + words*8 + LIFE_PAD;
+	life_grid_size = (rows+2)*life_stride;
+	life_state = life_map(life_grid_size);
+	life_buffer = life_map(life_grid_size);
+	
+	errno = 0;
+	life_tiles_x = words*8/LIFE_TILE_BYTES;
+	life_tiles_y = (rows+LIFE_TILE_ROWS-1)/LIFE_TILE_ROWS;
+	tmp[0] = realloc(life_active,life_tiles_x*life_tiles_y+1);
+	tmp[1] = realloc(life_changed,life_tiles_x*life_tiles_y+1);
+	tmp[2] = realloc(life_state_census,(life_tiles_x*life_tiles_y+1)*sizeof(struct life_census));
+	tmp[3] = realloc(life_buffer_census,(life_tiles_x*life_tiles_y+1)*sizeof(struct life_census));
+	free(life_wrap);
+	tmp[4] = calloc(1,life_stride);
+	if( !tmp[0] || !tmp[1] || !tmp[2] || !tmp[3] || !tmp[4] ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	life_active = tmp[0];
+	life_changed = tmp[1];
+	life_state_census = (struct life_census*)tmp[2];
+	life_buffer_census = (struct life_census*)tmp[3];
+	life_wrap = tmp[4];
+}
+
+//Make a world of size Bytes of the file from origin, copied to a grid
+//of its own a chunk of rows at a time.  Both grids start with it (see
+//life_restart()).  Holes are left alone, so they cost nothing.  A key
+//press between chunks drops the world half made and sets
+//life_seed_stopped until the key is read.
+#define LIFE_SEED_CHUNK (1024*1024)
+
+static int life_seed_stopped = 0;
+
+static void life_seed(off_t origin, size_t size) {
+	size_t row_len = buffer_width/8;
+	size_t rows, chunk, y, i, n, len;
+	off_t pos;
+	uint8_t* bounce = 0;
+	const uint8_t* src;
+	
+	life_alloc(origin,size);
+	rows = (life_size+row_len-1)/row_len;
+	errno = 0;
+	chunk = LIFE_SEED_CHUNK/row_len ? LIFE_SEED_CHUNK/row_len : 1;
+	if( !file_map && !(bounce = malloc(chunk*row_len)) ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	
+	for( y=0; y<rows; y+=n ) {
+		n = rows-y < chunk ? rows-y : chunk;
+		pos = life_origin + y*row_len;
+		len = life_size - y*row_len < n*row_len ? life_size - y*row_len : n*row_len;
+		if( in_hole(pos,len) ) {
+			continue;
+		}
+		if( y && key_waiting() ) {
+			free(bounce);
+			life_free();
+			life_seed_stopped = 1;
+			return;
+		}
+		if( file_map ) {
+			src = file_map + pos;
+		}
+		else {
+			source_read(bounce,len,pos);
+			src = bounce;
+		}
+		for( i=0; i<n; i++ ) {
+			memcpy(life_row(life_state,y+i),src+i*row_len,len-i*row_len < row_len ? len-i*row_len : row_len);
+			memcpy(life_row(life_buffer,y+i),src+i*row_len,len-i*row_len < row_len ? len-i*row_len : row_len);
+		}
+	}
+	free(bounce);
+	life_generation = 0;
+	life_restart();
+	life_tune();
+}
+
+//Life's world is the whole file, from the first row boundary of the
+//view onwards
+static void life_setup() {
+	size_t row_len = buffer_width/8;
+	
+	if( life_state || !row_len ) {
+		return;
+	}
+	life_seed(offset % row_len,fd_size - offset % row_len);
+}
+
+//Cut the world down to n of its rows from row y, where it has got to
+static void life_crop(size_t y, size_t n) {
+	size_t row_len = buffer_width/8;
+	size_t grid_size = life_grid_size;
+	uint8_t* state = life_state;
+	uint8_t* buffer = life_buffer;
+	size_t i;
+	
+	if( n > (life_size+row_len-1)/row_len - y ) {
+		n = (life_size+row_len-1)/row_len - y;
+	}
+	life_alloc(life_origin + y*row_len,life_size - y*row_len < n*row_len ? life_size - y*row_len : n*row_len);
+	for( i=0; i<n; i++ ) {
+		memcpy(life_row(life_state,i),life_row(state,y+i),row_len);
+	}
+	memcpy(life_buffer,life_state,life_grid_size);
+	munmap(state,grid_size);
+	munmap(buffer,grid_size);
+	life_restart();
+}
+
+//Fill the padding around the h rows of the current generation with
+//what lies beyond the edges, the row below going in bottom.  On a plane
+//it stays dead.  A torus wraps both ways; a Klein bottle wraps sideways
+//and flips left to right across the top and bottom.  Only the Byte
+//either side of a row is ever read, and its edge bit is the cell across
+//the wrap.
+static void life_halo(size_t h, size_t row_len, uint8_t* bottom) {
+	uint8_t* row;
+	uint8_t* top = life_row(life_state,0) - life_stride;
+	size_t x, y;
+	
+	if( life_topology == LIFE_PLANE || !h ) {
+		return;
+	}
+	for( y=0; y<h; y++ ) {
+		row = life_row(life_state,y);
+		row[-1] = row[row_len-1];
+		row[row_len] = row[0];
+	}
+	if( life_topology == LIFE_TORUS ) {
+		memcpy(top-1,life_row(life_state,h-1)-1,row_len+2);
+		memcpy(bottom-1,life_row(life_state,0)-1,row_len+2);
+		return;
+	}
+	for( x=0; x<row_len; x++ ) {
+		top[x] = reverse_bits(life_row(life_state,h-1)[row_len-1-x]);
+		bottom[x] = reverse_bits(life_row(life_state,0)[row_len-1-x]);
+	}
+	top[-1] = top[row_len-1];
+	top[row_len] = top[0];
+	bottom[-1] = bottom[row_len-1];
+	bottom[row_len] = bottom[0];
+}
+
+//Mark the tiles to step this generation: those next to one that
+//changed last time.  With the edges joined up, a change in any edge
+//tile wakes them all, which is simpler than working out which tiles
+//face each other across the wrap and costs little.
+static size_t life_tiles_activate() {
+	size_t tx, ty, x, y;
+	size_t count = 0;
+	int edge = 0;
+	
+	memset(life_active,0,life_tiles_x*life_tiles_y);
+	for( ty=0; ty<life_tiles_y; ty++ ) {
+		for( tx=0; tx<life_tiles_x; tx++ ) {
+			if( !life_changed[ty*life_tiles_x+tx] ) {
+				continue;
+			}
+			for( y = ty ? ty-1 : 0; y<=ty+1 && y<life_tiles_y; y++ ) {
+				for( x = tx ? tx-1 : 0; x<=tx+1 && x<life_tiles_x; x++ ) {
+					life_active[y*life_tiles_x+x] = 1;
+				}
+			}
+			if( !tx || !ty || tx == life_tiles_x-1 || ty == life_tiles_y-1 ) {
+				edge = 1;
+			}
+		}
+	}
+	if( edge && life_topology != LIFE_PLANE ) {
+		for( ty=0; ty<life_tiles_y; ty++ ) {
+			life_active[ty*life_tiles_x] = 1;
+			life_active[ty*life_tiles_x+life_tiles_x-1] = 1;
+		}
+		memset(life_active,1,life_tiles_x);
+		memset(life_active+(life_tiles_y-1)*life_tiles_x,1,life_tiles_x);
+	}
+	memset(life_changed,0,life_tiles_x*life_tiles_y);
+	for( tx=0; tx<life_tiles_x*life_tiles_y; tx++ ) {
+		count += life_active[tx];
+	}
+	return count;
+}
+
+//Advance the displayed bits one generation under life_birth and
+//life_survive, with the edges joined up as life_topology says.
+//Work out the next generation in life_buffer.  Of life_state only the
+//halo is written, so the current generation can be drawn meanwhile.
+static void life_evolve() {
+	size_t row_len = buffer_width/8;
+	size_t words = (row_len+LIFE_ROW_ALIGN-1)/LIFE_ROW_ALIGN*(LIFE_ROW_ALIGN/8);
+	size_t h, rows, active, y;
+	
+	h = life_size/row_len;
+	rows = (life_size+row_len-1)/row_len;
+	//The partial last row dies in the first generation, after which it
+	//can't change anything around it
+	if( rows > h && life_topology == LIFE_PLANE && life_tiles_y && memcmp(life_row(life_state,h),life_row(life_buffer,h),row_len) ) {
+		memset(life_changed+(life_tiles_y-1)*life_tiles_x,1,life_tiles_x);
+	}
+	active = life_tiles_activate();
+	//A wrapped world's partial last row would be written over by the
+	//wrap, so the wrap goes in a row of its own
+	life_job_bottom = life_topology != LIFE_PLANE && rows > h ? life_wrap + LIFE_PAD : life_row(life_state,h);
+	life_halo(h,row_len,life_job_bottom);
+	
+	if( !life_threads ) {
+		life_pool_setup();
+	}
+	life_job_rows = h;
+	life_job_words = words;
+	life_job_row_len = row_len;
+	life_job_bands = active*LIFE_TILE_ROWS*LIFE_TILE_BYTES/LIFE_BAND_MIN;
+	if( life_job_bands > life_threads ) {
+		life_job_bands = life_threads;
+	}
+	if( !life_kernel_threaded ) {
+		life_job_bands = 1;
+	}
+	if( life_job_bands <= 1 ) {
+		life_job_bands = 1;
+		life_band(0);
+	}
+	else {
+		pthread_barrier_wait(&life_start);
+		life_band(0);
+		pthread_barrier_wait(&life_done);
+	}
+	//On a plane a partial last row takes part as a neighbour but doesn't
+	//live on.  A wrapped world leaves it out, as it is.
+	if( rows > h && life_topology == LIFE_PLANE ) {
+		memset(life_row(life_buffer,h),0,row_len);
+	}
+	else if( rows > h ) {
+		memcpy(life_row(life_buffer,h),life_row(life_state,h),row_len);
+	}
+	//The halo past the right edge shares a tile with the last cells,
+	//and mustn't be there when this grid is next written to
+	if( life_topology != LIFE_PLANE ) {
+		for( y=0; y<h; y++ ) {
+			life_row(life_state,y)[row_len] = 0;
+		}
+	}
+}
+
+//Make the next generation the current one
+static void life_swap() {
+	uint8_t* tmp;
+	struct life_census* census;
+	
+	tmp = life_state;
+	life_state = life_buffer;
+	life_buffer = tmp;
+	census = life_state_census;
+	life_state_census = life_buffer_census;
+	life_buffer_census = census;
+	life_generation++;
+	life_count();
+}
+
+static void step_life() {
+	if( !(buffer_width/8) ) {
+		return;
+	}
+	life_setup();
+	if( !life_state ) {
+		return;
+	}
+	life_evolve();
+	life_swap();
+}
+
+//With -G, Life runs on a thread of its own at life_rate generations a
+//second, or as fast as it can for 0, and the screen is redrawn
+//frame_rate times a second with whichever generation is current.  The
+//main thread holds life_lock whenever it handles keys or draws.  The
+//Life thread holds it to start a generation and to make it current, but
+//not while working it out.
+static pthread_mutex_t life_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t life_wake;
+static pthread_cond_t life_idle = PTHREAD_COND_INITIALIZER;
+static int life_thread_started = 0;
+static int life_running = 0;
+static int life_busy = 0;
+
+static void* life_thread(void* arg) {
+	struct timespec due, now;
+	
+	(void)arg;
+	pthread_mutex_lock(&life_lock);
+	//The thread is usually started already running, without waiting
+	//below, so the first generation is due now
+	clock_gettime(CLOCK_MONOTONIC,&due);
+	for(;;) {
+		while( !life_running ) {
+			pthread_cond_wait(&life_wake,&life_lock);
+			clock_gettime(CLOCK_MONOTONIC,&due);
+		}
+		if( life_rate > 0 && pthread_cond_timedwait(&life_wake,&life_lock,&due) != ETIMEDOUT ) {
+			continue;
+		}
+		//As step_life(), there is no world without a row to build it on
+		life_setup();
+		if( !life_state ) {
+			life_running = 0;
+			continue;
+		}
+		life_busy = 1;
+		pthread_mutex_unlock(&life_lock);
+		life_evolve();
+		pthread_mutex_lock(&life_lock);
+		life_swap();
+		life_busy = 0;
+		if( life_period ) {
+			life_running = 0;
+		}
+		pthread_cond_broadcast(&life_idle);
+		
+		//Time lost while busy is dropped rather than caught up
+		if( life_rate > 0 ) {
+			due.tv_nsec += 1000000000/life_rate;
+			if( due.tv_nsec >= 1000000000 ) {
+				due.tv_sec++;
+				due.tv_nsec -= 1000000000;
+			}
+			clock_gettime(CLOCK_MONOTONIC,&now);
+			if( now.tv_sec > due.tv_sec || (now.tv_sec == due.tv_sec && now.tv_nsec > due.tv_nsec) ) {
+				due = now;
+			}
+		}
+	}
+	return 0;
+}
+
+//Start or stop the Life thread, with life_lock held.  Once it is told
+//to stop, this waits for the generation in hand to become current, so
+//the world can then be changed or dropped.
+static void life_thread_run(int on) {
+	pthread_t thread;
+	pthread_condattr_t attr;
+	
+	if( !life_thread_started ) {
+		if( !on ) {
+			return;
+		}
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr,CLOCK_MONOTONIC);
+		pthread_cond_init(&life_wake,&attr);
+		pthread_condattr_destroy(&attr);
+		if( (errno = pthread_create(&thread,0,life_thread,0)) ) {
+			ERROR("Thread creation error: %s\n",strerror(errno));
+		}
+		pthread_detach(thread);
+		life_thread_started = 1;
+	}
+	life_running = on;
+	pthread_cond_signal(&life_wake);
+	while( !on && life_busy ) {
+		pthread_cond_wait(&life_idle,&life_lock);
+	}
+}
+
+//HashLife: the plane as a quadtree of hash-consed nodes.  Each node of
+//level L (a square 2^L cells a side) caches its centre 2^j generations
+//on, so any region that recurs in space or time is only worked out
+//once and a jump of 2^k generations costs about as much as k steps.
+#define HASH_LEVELS 72
+#define HASH_JUMP_MAX 48
+//Nodes a jump may make.  A jump that needs more is given up.
+#define HASH_NODES_MAX (4*1024*1024)
+//A jump given up is made by stepping instead, up to 2^HASH_STEP_MAX
+//generations
+#define HASH_STEP_MAX 12
+//Random bits hardly recur, and a jump of 2^10 made about 90 nodes a
+//Byte of them, so a bigger world is cut down to the rows in view, and
+//no more than this many Bytes of them, before it jumps
+#define HASH_WORLD_MAX (32*1024)
+#define HASH_CHUNK 65536
+
+struct hnode {
+	struct hnode* nw;
+	struct hnode* ne;
+	struct hnode* sw;
+	struct hnode* se;
+	struct hnode* result;
+	struct hnode* next;
+	int level;
+	int result_j;
+	int alive;
+};
+
+static struct hnode** hash_table = 0;
+static size_t hash_buckets = 0;
+static size_t hash_count = 0;
+static struct hnode** hash_chunks = 0;
+static size_t hash_chunk_count = 0;
+static size_t hash_chunk_used = HASH_CHUNK;
+static struct hnode* hash_leaf[2];
+static struct hnode* hash_level1[16];
+static struct hnode* hash_empty[HASH_LEVELS];
+static int hash_jump = 10;
+//hash_join() gives up a jump by jumping back to hash_life() with
+//HASH_FULL once the nodes run out, or HASH_STOPPED on a key press
+#define HASH_DONE 0
+#define HASH_FULL 1
+#define HASH_STOPPED 2
+static jmp_buf hash_abort;
+static int hash_jumping = 0;
+
+static struct hnode* hash_alloc() {
+	struct hnode** tmp;
+	
+	if( hash_chunk_used == HASH_CHUNK ) {
+		errno = 0;
+		tmp = realloc(hash_chunks,(hash_chunk_count+1)*sizeof(struct hnode*));
+		if( !tmp ) {
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+		hash_chunks = tmp;
+		hash_chunks[hash_chunk_count] = malloc(HASH_CHUNK*sizeof(struct hnode));
+		if( !hash_chunks[hash_chunk_count] ) {
+			ERROR("Memory allocation error: %s\n",strerror(errno));
+		}
+		hash_chunk_count++;
+		hash_chunk_used = 0;
+	}
+	return hash_chunks[hash_chunk_count-1] + hash_chunk_used++;
+}
+
+static inline size_t hash_key(struct hnode* nw, struct hnode* ne, struct hnode* sw, struct hnode* se) {
+	uint64_t h;
+	
+	h = (uintptr_t)nw;
+	h = h*0x9E3779B97F4A7C15ull + (uintptr_t)ne;
+	h = h*0x9E3779B97F4A7C15ull + (uintptr_t)sw;
+	h = h*0x9E3779B97F4A7C15ull + (uintptr_t)se;
+	return (h ^ (h >> 29)) & (hash_buckets-1);
+}
+
+static void hash_grow() {
+	struct hnode** table;
+	struct hnode* n;
+	struct hnode* next;
+	size_t old = hash_buckets;
+	size_t i, key;
+	
+	errno = 0;
+	table = calloc(old ? old*2 : 1<<16,sizeof(struct hnode*));
+	if( !table ) {
+		ERROR("Memory allocation error: %s\n",strerror(errno));
+	}
+	hash_buckets = old ? old*2 : 1<<16;
+	for( i=0; i<old; i++ ) {
+		for( n=hash_table[i]; n; n=next ) {
+			next = n->next;
+			key = hash_key(n->nw,n->ne,n->sw,n->se);
+			n->next = table[key];
+			table[key] = n;
+		}
+	}
+	free(hash_table);
+	hash_table = table;
+}
+
+//The one node with these quadrants
+static struct hnode* hash_join(struct hnode* nw, struct hnode* ne, struct hnode* sw, struct hnode* se) {
+	struct hnode* n;
+	size_t key;
+	
+	key = hash_key(nw,ne,sw,se);
+	for( n=hash_table[key]; n; n=n->next ) {
+		if( n->nw == nw && n->ne == ne && n->sw == sw && n->se == se ) {
+			return n;
+		}
+	}
+	if( hash_jumping && hash_count >= HASH_NODES_MAX ) {
+		longjmp(hash_abort,HASH_FULL);
+	}
+	if( hash_jumping && hash_count % HASH_CHUNK == 0 && key_waiting() ) {
+		longjmp(hash_abort,HASH_STOPPED);
+	}
+	if( hash_count >= hash_buckets ) {
+		hash_grow();
+		key = hash_key(nw,ne,sw,se);
+	}
+	n = hash_alloc();
+	n->nw = nw;
+	n->ne = ne;
+	n->sw = sw;
+	n->se = se;
+	n->result = 0;
+	n->level = nw->level+1;
+	n->alive = nw->alive | ne->alive | sw->alive | se->alive;
+	n->next = hash_table[key];
+	hash_table[key] = n;
+	hash_count++;
+	return n;
+}
+
+//Drop every node and start again with just the leaves
+static void hash_reset() {
+	size_t i;
+	
+	for( i=0; i<hash_chunk_count; i++ ) {
+		free(hash_chunks[i]);
+	}
+	free(hash_chunks);
+	hash_chunks = 0;
+	hash_chunk_count = 0;
+	hash_chunk_used = HASH_CHUNK;
+	if( !hash_table ) {
+		hash_grow();
+	}
+	memset(hash_table,0,hash_buckets*sizeof(struct hnode*));
+	hash_count = 0;
+	
+	for( i=0; i<2; i++ ) {
+		hash_leaf[i] = hash_alloc();
+		memset(hash_leaf[i],0,sizeof(struct hnode));
+		hash_leaf[i]->alive = i;
+	}
+	//Level 1 nodes by their cells: bit 3 nw, 2 ne, 1 sw, 0 se
+	for( i=0; i<16; i++ ) {
+		hash_level1[i] = hash_join(hash_leaf[i>>3&1],hash_leaf[i>>2&1],hash_leaf[i>>1&1],hash_leaf[i&1]);
+	}
+	memset(hash_empty,0,sizeof(hash_empty));
+	hash_empty[0] = hash_leaf[0];
+	hash_empty[1] = hash_level1[0];
+}
+
+static struct hnode* hash_empty_node(int level) {
+	struct hnode* e;
+	
+	if( !hash_empty[level] ) {
+		e = hash_empty_node(level-1);
+		hash_empty[level] = hash_join(e,e,e,e);
+	}
+	return hash_empty[level];
+}
+
+static inline int life_cell(size_t x, size_t y) {
+	uint8_t byte = life_row(life_state,y)[x/8];
+	
+	return (byte >> (reverse_byte ? x%8 : 7-x%8)) & 1;
+}
+
+//The node for the square of 2^level cells a side at (x,y) of the grid
+//of w by h cells, which is all that is alive
+static struct hnode* hash_build(int level, int64_t x, int64_t y, int64_t w, int64_t h) {
+	int64_t half;
+	int i, bits = 0;
+	
+	if( x >= w || y >= h || x + ((int64_t)1<<level) <= 0 || y + ((int64_t)1<<level) <= 0 ) {
+		return hash_empty_node(level);
+	}
+	if( level == 1 ) {
+		for( i=0; i<4; i++ ) {
+			if( x+(i&1) >= 0 && x+(i&1) < w && y+(i>>1) >= 0 && y+(i>>1) < h ) {
+				bits |= life_cell(x+(i&1),y+(i>>1)) << (3-i);
+			}
+		}
+		return hash_level1[bits];
+	}
+	half = (int64_t)1 << (level-1);
+	return hash_join(hash_build(level-1,x,y,w,h),hash_build(level-1,x+half,y,w,h),
+	                 hash_build(level-1,x,y+half,w,h),hash_build(level-1,x+half,y+half,w,h));
+}
+
+//The centre quarter of n, as it is now
+static struct hnode* hash_centre(struct hnode* n) {
+	return hash_join(n->nw->se,n->ne->sw,n->sw->ne,n->se->nw);
+}
+
+//Centre 2x2 of a 4x4 node one generation on
+static struct hnode* hash_base(struct hnode* n) {
+	struct hnode* q[4] = { n->nw, n->ne, n->sw, n->se };
+	int cell[4][4];
+	int x, y, dx, dy, count;
+	int bits = 0;
+	
+	for( y=0; y<4; y++ ) {
+		for( x=0; x<4; x++ ) {
+			n = q[(y>>1)*2 + (x>>1)];
+			n = (y&1) ? ((x&1) ? n->se : n->sw) : ((x&1) ? n->ne : n->nw);
+			cell[y][x] = n->alive;
+		}
+	}
+	for( y=1; y<3; y++ ) {
+		for( x=1; x<3; x++ ) {
+			count = 0;
+			for( dy=-1; dy<=1; dy++ ) {
+				for( dx=-1; dx<=1; dx++ ) {
+					count += (dx || dy) && cell[y+dy][x+dx];
+				}
+			}
+			if( ((cell[y][x] ? life_survive : life_birth) >> count) & 1 ) {
+				bits |= 1 << (3 - ((y-1)*2 + (x-1)));
+			}
+		}
 	}
-	*width = ws.ws_col;
-	*height = ws.ws_row;
+	return hash_level1[bits];
 }
 
-static inline int getbit(uint8_t* buf, int x, int y) {
-	size_t bit_index; 
-	size_t byte_index;
-	uint8_t byte_shift;
+//The centre half (level L-1) of n, 2^j generations on (j <= L-2)
+static struct hnode* hash_step(struct hnode* n, int j) {
+	struct hnode* m[9];
+	struct hnode* r;
+	int sub;
+	int i;
 	
-	if( x < 0 || x >= buffer_width || y < 0 ) {
-		return 0;
+	if( n->result && n->result_j == j ) {
+		return n->result;
 	}
-	
-	bit_index = y*buffer_width + x;
-	byte_index = bit_index/8;
-	if( byte_index >= buffer_size ) {
-		return 0;
+	if( !n->alive ) {
+		return hash_empty_node(n->level-1);
 	}
-	if( reverse_byte ) {
-		byte_shift = bit_index%8;
+	if( n->level == 2 ) {
+		r = hash_base(n);
 	}
 	else {
-		byte_shift = 7-(bit_index%8);
+		//Nine overlapping squares of half the size
+		m[0] = n->nw;
+		m[1] = hash_join(n->nw->ne,n->ne->nw,n->nw->se,n->ne->sw);
+		m[2] = n->ne;
+		m[3] = hash_join(n->nw->sw,n->nw->se,n->sw->nw,n->sw->ne);
+		m[4] = hash_join(n->nw->se,n->ne->sw,n->sw->ne,n->se->nw);
+		m[5] = hash_join(n->ne->sw,n->ne->se,n->se->nw,n->se->ne);
+		m[6] = n->sw;
+		m[7] = hash_join(n->sw->ne,n->se->nw,n->sw->se,n->se->sw);
+		m[8] = n->se;
+		//At full speed both halves of the time step go through the
+		//cache; otherwise the first half is no time at all
+		sub = j == n->level-2 ? j-1 : j;
+		for( i=0; i<9; i++ ) {
+			m[i] = j == n->level-2 ? hash_step(m[i],sub) : hash_centre(m[i]);
+		}
+		r = hash_join(hash_step(hash_join(m[0],m[1],m[3],m[4]),sub),
+		              hash_step(hash_join(m[1],m[2],m[4],m[5]),sub),
+		              hash_step(hash_join(m[3],m[4],m[6],m[7]),sub),
+		              hash_step(hash_join(m[4],m[5],m[7],m[8]),sub));
 	}
-	return (buf[byte_index]>>byte_shift) & 1;
+	n->result = r;
+	n->result_j = j;
+	return r;
 }
 
-static inline void setbit(uint8_t* buf, int x, int y) {
-	size_t bit_index; 
-	size_t byte_index;
-	uint8_t byte_shift;
+//Set the cells of the square of 2^level at (x,y) that are alive in n
+//and inside the first w by h cells of the grid in life_buffer
+static void hash_extract(struct hnode* n, int level, int64_t x, int64_t y, int64_t w, int64_t h) {
+	int64_t half;
 	
-	if( x < 0 || x > buffer_width || y < 0 ) {
+	if( !n->alive || x >= w || y >= h ) {
 		return;
 	}
-	
-	bit_index = y*buffer_width+x;
-	byte_index = bit_index/8;
-	if( byte_index > buffer_size ) {
+	if( level == 0 ) {
+		life_row(life_buffer,y)[x/8] |= 1 << (reverse_byte ? x%8 : 7-x%8);
 		return;
 	}
-	if( reverse_byte ) {
-		byte_shift = bit_index%8;
+	half = (int64_t)1 << (level-1);
+	hash_extract(n->nw,level-1,x,y,w,h);
+	hash_extract(n->ne,level-1,x+half,y,w,h);
+	hash_extract(n->sw,level-1,x,y+half,w,h);
+	hash_extract(n->se,level-1,x+half,y+half,w,h);
+}
+
+//Work out the w by h grid (of rows counting a partial one) 2^hash_jump
+//generations on into life_buffer.  hash_join() may longjmp() out.
+static void hash_life_jump(int64_t w, int64_t h, int64_t rows) {
+	int64_t origin;
+	struct hnode* root;
+	int level = 3;
+	
+	//The grid goes at the top left of the centre half of the root,
+	//which is what hash_step() returns
+	while( ((int64_t)1 << (level-1)) < (w > rows ? w : rows) || level < hash_jump+2 ) {
+		level++;
 	}
-	else {
-		byte_shift = 7-(bit_index%8);
+	origin = (int64_t)1 << (level-2);
+	root = hash_build(level,-origin,-origin,w,rows);
+	root = hash_step(root,hash_jump);
+	hash_jumping = 0;
+	
+	memset(life_buffer,0,life_grid_size);
+	hash_extract(root,level-1,0,0,w,h);
+}
+
+//Jump Life 2^hash_jump generations on.  HashLife works on the
+//unbounded plane, so unlike step_life() patterns can leave the view
+//and come back; what ends up inside it is kept.  Worlds over
+//HASH_WORLD_MAX are cut down to the rows in view first.  A jump that runs out
+//of nodes is stepped instead if it is short enough, and a key press
+//stops stepping at the generation it got to.  Returns HASH_DONE, or
+//why the world didn't move: out of nodes, or a key press mid jump.
+static int hash_life() {
+	int64_t w = buffer_width;
+	int64_t h, rows;
+	uint8_t* tmp;
+	uint64_t i;
+	size_t window = (size_t)frame_h*glyph_h;
+	int result;
+	
+	if( !buffer_width ) {
+		return HASH_DONE;
+	}
+	if( window > (size_t)(HASH_WORLD_MAX/(w/8)) ) {
+		window = HASH_WORLD_MAX/(w/8) ? HASH_WORLD_MAX/(w/8) : 1;
+	}
+	if( !life_state && fd_size - offset % (w/8) > HASH_WORLD_MAX ) {
+		life_seed(offset,fd_size - offset < (off_t)(window*(w/8)) ? (size_t)(fd_size - offset) : window*(w/8));
+	}
+	else if( life_state && life_size > HASH_WORLD_MAX ) {
+		life_crop((offset - life_origin)/(w/8),window);
+	}
+	life_setup();
+	if( !life_state ) {
+		return HASH_STOPPED;
+	}
+	h = life_size/(w/8);
+	rows = (life_size+w/8-1)/(w/8);
+	//Nodes from earlier jumps are kept while they leave this one room
+	if( !hash_table || hash_count > HASH_NODES_MAX/2 ) {
+		hash_reset();
 	}
-	buf[byte_index] |= (1<<byte_shift);
+	
+	if( (result = setjmp(hash_abort)) ) {
+		hash_jumping = 0;
+		hash_reset();
+		if( result == HASH_STOPPED || hash_jump > HASH_STEP_MAX ) {
+			return result;
+		}
+		for( i=0; i<(uint64_t)1 << hash_jump && !key_waiting(); i++ ) {
+			step_life();
+		}
+		return HASH_DONE;
+	}
+	//Nothing changed from here on may be used after a longjmp() back,
+	//so the jump itself is done in a function of its own
+	hash_jumping = 1;
+	hash_life_jump(w,h,rows);
+	tmp = life_state;
+	life_state = life_buffer;
+	life_buffer = tmp;
+	memcpy(life_buffer,life_state,life_grid_size);
+	life_generation += (uint64_t)1 << hash_jump;
+	life_restart();
+	return HASH_DONE;
 }
 
-static uint32_t sextant_chars[64] = {
-	0x00020,0x1FB1E,0x1FB0F,0x1FB2D,0x1FB07,0x1FB26,0x1FB16,0x1FB35,
-	0x1FB03,0x1FB22,0x1FB13,0x1FB31,0x1FB0B,0x1FB29,0x1FB1A,0x1FB39,
-	0x1FB01,0x1FB20,0x1FB11,0x1FB2F,0x1FB09,0x02590,0x1FB18,0x1FB37,
-	0x1FB05,0x1FB24,0x1FB14,0x1FB33,0x1FB0D,0x1FB2B,0x1FB1C,0x1FB3B,
-	0x1FB00,0x1FB1F,0x1FB10,0x1FB2E,0x1FB08,0x1FB27,0x1FB17,0x1FB36,
-	0x1FB04,0x1FB23,0x0258C,0x1FB32,0x1FB0C,0x1FB2A,0x1FB1B,0x1FB3A,
-	0x1FB02,0x1FB21,0x1FB12,0x1FB30,0x1FB0A,0x1FB28,0x1FB19,0x1FB38,
-	0x1FB06,0x1FB25,0x1FB15,0x1FB34,0x1FB0E,0x1FB2C,0x1FB1D,0x02588
-};
+#define KEY_IGNORE 0
+#define KEY_UPDATE 1
+#define KEY_QUIT   2
+#define KEY_REDRAW 3
 
-static void update() {
-	int term_w, term_h;
-	int char_x, char_y;
-	int disp_w;
-	int off_x;
-	size_t new_buffer_size;
-	uint8_t* tmp;
-	uint8_t index;
+//Length of the key (or escape sequence) at the start of input
+static int key_length(const uint8_t* input, int len) {
+	int i;
 	
-	term_size(&term_w,&term_h);
-	if(   term_h != last_term_h || 
-	      term_w != last_term_w || 
-	      buffer_offset != offset ) {
-		//If left unset, set buffer_width the maximum displayable
-		//number of bits
-		if( !buffer_width ) {
-			buffer_width = term_w*2;
+	if( len >= 2 && input[0] == 0x1B && (input[1] == 0x5B || input[1] == 0x4F) ) {
+		for( i=2; i<len; i++ ) {
+			if( input[i] >= 0x40 && input[i] <= 0x7E ) {
+				return i+1;
+			}
 		}
-		if( buffer_width % 8 ) {
-			buffer_width = buffer_width - (buffer_width % 8);
+		return len;
+	}
+	return 1;
+}
+
+//Apply a single key.  Returns KEY_UPDATE if the view moved, or
+//KEY_REDRAW if only what is drawn over it changed.
+static int run_key(const uint8_t* input, int len) {
+	char status[160];
+	off_t old;
+	int n, i, y;
+	//Whether this key stopped Life's world being seeded
+	int stopped = life_seed_stopped;
+	
+	life_seed_stopped = 0;
+	//Regular Input
+	if( len == 1 ) {
+		if( input[0] == 0x1b ) {
+			return KEY_QUIT;
 		}
-		
-		//Determine (based on current terminal size)
-		//how many Bytes of data can be displayed and resize
-		//buffer to accept them
-		new_buffer_size = (term_h*3) * buffer_width;
-		if( new_buffer_size % 8 ) {
-			new_buffer_size = new_buffer_size/8+1;
+		if( input[0] == 'q' || input[0] == 'Q' ) {
+			return KEY_QUIT;
 		}
-		else {
-			new_buffer_size = new_buffer_size/8;
+		else if( input[0] == 'i' || input[0] == 'I' ) {
+			n = snprintf(status,sizeof(status),"File Offset: 0x%08lx  Bit Offset: 0x%08x",offset,col_offset);
+			if( view_zoom ) {
+				n += snprintf(status+n,sizeof(status)-n,"  Zoom: 2^%d bits a pixel, %s",view_zoom,zoom_names[zoom_mode]);
+			}
+			if( view_zoom && zoom_mode == ZOOM_DENSITY ) {
+				snprintf(status+n,sizeof(status)-n," %d%%",zoom_threshold);
+			}
+			show_status(status);
+			return KEY_IGNORE;
 		}
-		if( new_buffer_size > fd_size ) {
-			new_buffer_size = fd_size;
+		else if( input[0] == 'h' || input[0] == 'H' ) {
+			col_offset--;
 		}
-		if( new_buffer_size != buffer_size ) {
-			errno = 0;
-			tmp = realloc(buffer,new_buffer_size);
-			if( !tmp ) {
-				free(buffer);
-				ERROR("Memory allocation error: %s\n",strerror(errno));
+		else if( input[0] == 'j' ) {
+			offset = offset + ((off_t)(buffer_width/8) << view_zoom);
+		}
+		else if( input[0] == 'k' ) {
+			offset = offset - ((off_t)(buffer_width/8) << view_zoom);
+		}
+		//One text row (glyph_h bit rows), which the terminal can scroll
+		else if( input[0] == 'J' ) {
+			offset = offset + ((off_t)(buffer_width/8*glyph_h) << view_zoom);
+		}
+		else if( input[0] == 'K' ) {
+			offset = offset - ((off_t)(buffer_width/8*glyph_h) << view_zoom);
+		}
+		else if( input[0] == 'l' || input[0] == 'L' ) {
+			col_offset++;
+		}
+		//Run or pause Life.  Once it has settled into a cycle, run on
+		//until the cycle comes round again, with the history of hashes
+		//forgotten so the repeat just found doesn't stop it at once.
+		else if( input[0] == 'r' || input[0] == 'R' ) {
+			wolfram_free();
+			if( stopped || (life && !life_period) ) {
+				life = 0;
+				return KEY_REDRAW;
+			}
+			if( !life_state ) {
+				show_status("Seeding Life from the file... (any key stops it)");
 			}
-			buffer = tmp;
-			buffer_size = new_buffer_size;
+			life = 1;
+			if( life_period ) {
+				life_period = 0;
+				life_history_len = 0;
+			}
+			return KEY_IGNORE;
 		}
-		
-		//Seek and read the file
-		if( offset + buffer_size > fd_size ) {
-			offset = fd_size - buffer_size;
+		else if( input[0] == 'x' || input[0] == 'X' ) {
+			life = 0;
+			life_thread_run(0);
+			life_free();
+			wolfram_free();
 		}
-		if( offset < 0 ) {
-			offset = 0;
+		//Start (or stop) a waterfall from the top row of the view
+		else if( input[0] == 'e' || input[0] == 'E' ) {
+			if( wolfram_ring ) {
+				wolfram_free();
+			}
+			else {
+				life = 0;
+				life_thread_run(0);
+				wolfram_setup(frame_h*glyph_h);
+			}
 		}
-		errno = 0;
-		if( lseek(fd,offset,SEEK_SET) < 0 ) {
-			ERROR("File seek error: %s",strerror(errno));
+		else if( input[0] == 'n' || input[0] == 'N' ) {
+			jump_extent(1);
 		}
-		errno = 0;
-		if( read(fd,buffer,buffer_size) != (ssize_t)buffer_size ) {
-			ERROR("File read error: %s\n",strerror(errno));
+		else if( input[0] == 'p' || input[0] == 'P' ) {
+			jump_extent(-1);
 		}
-
-		last_term_h = term_h;
-		last_term_w = term_w;
-		buffer_offset = offset;
-	}
-	
-	if( col_offset + term_w*2 > buffer_width ) {
-		col_offset = buffer_width - term_w*2;
-	}
-	if( col_offset < 0 ) {
-		col_offset = 0;
-	}
-	
-	disp_w = buffer_width/2;
-	if( disp_w > term_w ) {
-		disp_w = term_w;
-	}
-	
-	printf("\x1b[2J\x1b[H\x1b[0m");
-	for( char_y=0; char_y<term_h; char_y++ ) {
-		if( char_y ) {
-			printf("\n");
+		else if( input[0] == 'g' || input[0] == 'G' ) {
+			//Empty space must stay empty
+			if( life_topology != LIFE_PLANE || (life_birth & 1) ) {
+				show_status("Jumps need -Tplane and a rule without B0");
+				return KEY_IGNORE;
+			}
+			life_thread_run(0);
+			wolfram_free();
+			if( life_state && life_size > HASH_WORLD_MAX ) {
+				snprintf(status,sizeof(status),"World over %d KiB: dropping all but the rows in view to jump them... (any key stops it)",HASH_WORLD_MAX/1024);
+				show_status(status);
+			}
+			else if( !life_state && fd_size > HASH_WORLD_MAX ) {
+				snprintf(status,sizeof(status),"Jumping the rows in view, as the file is over %d KiB... (any key stops it)",HASH_WORLD_MAX/1024);
+				show_status(status);
+			}
+			else {
+				show_status("Jumping... (any key stops it)");
+			}
+			n = hash_life();
+			if( n == HASH_FULL ) {
+				snprintf(status,sizeof(status),"Jump needs over %d M nodes; a smaller one (<) may do",HASH_NODES_MAX/(1024*1024));
+				show_status(status);
+				return KEY_IGNORE;
+			}
+			if( n == HASH_STOPPED ) {
+				show_status("Jump stopped");
+				return KEY_IGNORE;
+			}
+			return KEY_REDRAW;
 		}
-		for( char_x=0; char_x<disp_w; char_x++ ) {
-			off_x = col_offset + char_x*2;
-			index = 0;
-			index = (index<<1) | getbit(buffer,off_x  , char_y*3   );
-			index = (index<<1) | getbit(buffer,off_x+1, char_y*3   );
-			index = (index<<1) | getbit(buffer,off_x  ,(char_y*3)+1);
-			index = (index<<1) | getbit(buffer,off_x+1,(char_y*3)+1);
-			index = (index<<1) | getbit(buffer,off_x  ,(char_y*3)+2);
-			index = (index<<1) | getbit(buffer,off_x+1,(char_y*3)+2);
-			printf("%s",utf8_encode(0,sextant_chars[index]));
+		//Time the Life kernels on the world again and show how they did
+		else if( input[0] == 't' || input[0] == 'T' ) {
+			life_thread_run(0);
+			if( !life_state ) {
+				show_status("Seeding Life from the file... (any key stops it)");
+				life_setup();
+				if( !life_state ) {
+					return KEY_REDRAW;
+				}
+			}
+			else {
+				life_tune();
+			}
+			n = snprintf(status,sizeof(status),"Tuned on %zu KiB:",life_tune_rows*(buffer_width/8)/1024);
+			for( i=0; i<life_kernel_count && n < (int)sizeof(status); i++ ) {
+				if( life_kernels[i].ns[1] ) {
+					n += snprintf(status+n,sizeof(status)-n," %s %llu/%lluus",life_kernels[i].name,
+					              (unsigned long long)life_kernels[i].ns[0]/1000,(unsigned long long)life_kernels[i].ns[1]/1000);
+				}
+				else {
+					n += snprintf(status+n,sizeof(status)-n," %s %lluus",life_kernels[i].name,
+					              (unsigned long long)life_kernels[i].ns[0]/1000);
+				}
+			}
+			show_status(status);
+			return KEY_IGNORE;
 		}
-	}
-	fflush(stdout);
-}
-
-static void step_life() {
-	int count;
-	int x,y;
-	int h = (buffer_size*8)/buffer_width;
-	if( !life_buffer ) {
-		life_buffer = malloc(buffer_size);
-	}
-	memset(life_buffer,0,buffer_size);
-	for( y=0; y<h; y++ ) {
-		for( x=0; x<buffer_width; x++ ) {
-			count = 0;
-			count += getbit(buffer,x-1,y-1);
-			count += getbit(buffer,x  ,y-1);
-			count += getbit(buffer,x+1,y-1);
-			count += getbit(buffer,x-1,y  );
-			count += getbit(buffer,x+1,y  );
-			count += getbit(buffer,x-1,y+1);
-			count += getbit(buffer,x  ,y+1);
-			count += getbit(buffer,x+1,y+1);
-			if( getbit(buffer,x,y) ) {
-				if( count == 2 || count == 3 ) {
-					setbit(life_buffer,x,y);
+		else if( input[0] == '<' || input[0] == '>' ) {
+			hash_jump += input[0] == '>' ? 1 : -1;
+			if( hash_jump < 0 ) {
+				hash_jump = 0;
+			}
+			if( hash_jump > HASH_JUMP_MAX ) {
+				hash_jump = HASH_JUMP_MAX;
+			}
+			snprintf(status,sizeof(status),"Jump: 2^%d generations",hash_jump);
+			show_status(status);
+			return KEY_IGNORE;
+		}
+		//Zoom in or out by a power of two bits a pixel, as far as one
+		//pixel for the whole file
+		else if( input[0] == '+' || input[0] == '=' || input[0] == '-' || input[0] == '_' ) {
+			if( life_state || wolfram_ring ) {
+				show_status("Zoom shows the file; x drops Life's world first");
+				return KEY_IGNORE;
+			}
+			if( input[0] == '-' || input[0] == '_' ) {
+				if( zoom_shift < ZOOM_MAX && ((off_t)1 << zoom_shift) < fd_size*8 ) {
+					zoom_shift++;
+				}
+			}
+			else if( zoom_shift > 0 ) {
+				zoom_shift--;
+			}
+			buffer_offset = -1;
+		}
+		//Cycle how a zoomed out pixel sums up its bits
+		else if( input[0] == 'a' || input[0] == 'A' ) {
+			zoom_mode = (zoom_mode+1) % 3;
+			buffer_offset = -1;
+		}
+		else if( input[0] == 'm' ) {
+			hole_map = !hole_map;
+			frame_invalidate_row(frame_h-1);
+			return KEY_REDRAW;
+		}
+		//Show or hide the minimap, building its pyramid the first time
+		else if( input[0] == 'M' ) {
+			minimap = !minimap;
+			pyramid_setup();
+			for( i=0; i<frame_h; i++ ) {
+				frame_invalidate_row(i);
+			}
+			return KEY_REDRAW;
+		}
+		//Jump a tenth of the way at a time through the file
+		else if( input[0] >= '0' && input[0] <= '9' ) {
+			jump_to(fd_size*(input[0]-'0')/10);
+		}
+		//Jump to the previous or next row of the minimap, as far as it
+		//takes to move the view
+		else if( (input[0] == '[' || input[0] == ']') && minimap_rows > 0 && fd_size > 0 ) {
+			old = offset;
+			y = offset*minimap_rows/fd_size;
+			if( input[0] == ']' ) {
+				for( i=y+1; i<minimap_rows && offset == old; i++ ) {
+					jump_to(fd_size*i/minimap_rows);
 				}
 			}
 			else {
-				if( count == 3 ) {
-					setbit(life_buffer,x,y);
+				for( i=y; i>=0 && offset == old; i-- ) {
+					jump_to(fd_size*i/minimap_rows);
 				}
 			}
 		}
 	}
-	memcpy(buffer,life_buffer,buffer_size);
+	else if( len == 3 ) {
+		if( input[0] == 0x1B && (input[1] == 0x5B || input[1] == 0x4F) ) {
+			if( input[2] == DIRUP ) { //Arrow Up
+				offset = offset - ((off_t)(buffer_width/8) << view_zoom);
+			}
+			else if( input[2] == DIRDN ) { //Arrow Down
+				offset = offset + ((off_t)(buffer_width/8) << view_zoom);
+			}
+			else if( input[2] == DIRRT ) { //Arrow Right
+				col_offset++;
+			}
+			else if( input[2] == DIRLT ) { //Arrow Left
+				col_offset--;
+			}
+			else if( input[2] == 0x46 ) { //End
+				offset = fd_size;
+			}
+			else if( input[2] == 0x48 ) { //Home
+				offset = 0;
+			}
+		}
+	}
+	else if( len == 4 ) {
+		if( input[0] == 0x1B && input[1] == 0x5B && input[3] == 0x7E ) {
+			if( input[2] == 0x35 ) { //Page Up
+				offset = offset - ((off_t)buffer_size << view_zoom);
+			}
+			else if( input[2] == 0x36 ) { //Page Down
+				offset = offset + ((off_t)buffer_size << view_zoom);
+			}
+		}
+	}
+	return KEY_UPDATE;
 }
 
-void run_sigint_handler(int signalId) {
-	(void)signalId;
-	term_reset();
-	exit(0);
+//Start (or stop) the timer that steps Life every delay_ms, or with -G
+//draws a frame frame_rate times a second.  The first is due straight
+//away.  The interval is kept by the kernel, so time spent rendering
+//doesn't stretch it.
+static void life_timer(int tfd, int on) {
+	struct itimerspec spec;
+	long ns = life_rate < 0 ? delay_ms*1000000L : 1000000000L/frame_rate;
+	
+	memset(&spec,0,sizeof(spec));
+	if( on && ns > 0 ) {
+		spec.it_value.tv_nsec = 1;
+		spec.it_interval.tv_sec = ns/1000000000;
+		spec.it_interval.tv_nsec = ns%1000000000;
+	}
+	timerfd_settime(tfd,0,&spec,0);
 }
 
 static void run() {
-	uint8_t input[8];
+	uint8_t input[64];
 	ssize_t inputlen;
-	struct sigaction action;
+	int pos, len;
+	int action;
+	int redraw;
+	int step;
+	int ticking = 0;
+	uint64_t shown = 0;
+	int sfd, tfd;
+	int i;
+	sigset_t mask;
+	struct signalfd_siginfo info;
+	struct pollfd fds[4];
+	uint64_t ticks;
 	
-	action.sa_handler = run_sigint_handler;
-	sigaction(SIGINT, &action, 0);
+	//Signals are read from a signalfd.  They must be blocked before the
+	//prefetch thread starts so it inherits the mask.
+	sigemptyset(&mask);
+	sigaddset(&mask,SIGINT);
+	sigaddset(&mask,SIGWINCH);
+	pthread_sigmask(SIG_BLOCK,&mask,0);
+	errno = 0;
+	if( (sfd = signalfd(-1,&mask,SFD_NONBLOCK|SFD_CLOEXEC)) < 0 ) {
+		TERM_ERROR("Error creating signalfd: %s\n",strerror(errno));
+	}
+	errno = 0;
+	if( (tfd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC)) < 0 ) {
+		TERM_ERROR("Error creating timerfd: %s\n",strerror(errno));
+	}
+	errno = 0;
+	if( (pyramid_event = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC)) < 0 ) {
+		TERM_ERROR("Error creating eventfd: %s\n",strerror(errno));
+	}
 	
+	map_file();
+	find_extents();
+	if( !file_map ) {
+		cache_setup();
+	}
 	term_setup();
 	update();
 	
+	fds[0].fd = STDIN_FILENO;
+	fds[1].fd = sfd;
+	fds[2].fd = tfd;
+	fds[3].fd = pyramid_event;
+	for( i=0; i<4; i++ ) {
+		fds[i].events = POLLIN;
+	}
 	for(;;) {
-		memset(input,0,sizeof(input));
-		inputlen = read(STDIN_FILENO,&input,sizeof(input));
-		if( inputlen < 0 ) {
-			if( errno != EAGAIN ) {
-				break;
-			}
-			if( life ) {
-				step_life();
-				update();
-				usleep(delay_ms*1000);
-			}
-			else {
-				usleep(100000);
+		//With no delay, Life runs whenever there is nothing else to do
+		if( poll(fds,4,ticking && life_rate < 0 && delay_ms <= 0 ? 0 : -1) < 0 ) {
+			if( errno == EINTR ) {
+				continue;
 			}
-			continue;
+			break;
 		}
-		//Regular Input
-		else if( inputlen == 1 ) {
-			if( input[0] == 0x1b ) {
-				break;
+		redraw = 0;
+		step = ticking && life_rate < 0 && delay_ms <= 0;
+		pthread_mutex_lock(&life_lock);
+		
+		while( read(sfd,&info,sizeof(info)) == sizeof(info) ) {
+			if( info.ssi_signo == SIGINT ) {
+				goto done;
 			}
-			if( input[0] == 'q' || input[0] == 'Q' ) {
+			term_resized = 1;
+			redraw = 1;
+		}
+		//Ticks missed while busy are dropped rather than caught up
+		if( read(tfd,&ticks,sizeof(ticks)) == sizeof(ticks) ) {
+			step = ticking;
+		}
+		//More of the minimap is known
+		if( read(pyramid_event,&ticks,sizeof(ticks)) == sizeof(ticks) && minimap ) {
+			redraw = 1;
+		}
+		
+		//Apply all pending input (e.g. key repeat) and draw its
+		//combined effect once
+		while( fds[0].revents ) {
+			inputlen = read(STDIN_FILENO,&input,sizeof(input));
+			if( inputlen < 0 && errno == EAGAIN ) {
 				break;
 			}
-			else if( input[0] == 'i' || input[0] == 'I' ) {
-				printf("\rFile Offset: 0x%08lx  Bit Offset: 0x%08x",offset,col_offset);
-				fflush(stdout);
+			if( inputlen < 0 && errno == EINTR ) {
 				continue;
 			}
-			else if( input[0] == 'h' || input[0] == 'H' ) {
-				col_offset--;
-			}
-			else if( input[0] == 'j' || input[0] == 'J' ) {
-				offset = offset + buffer_width/8;
-			}
-			else if( input[0] == 'k' || input[0] == 'K' ) {
-				offset = offset - buffer_width/8;
-			}
-			else if( input[0] == 'l' || input[0] == 'L' ) {
-				col_offset++;
-			}
-			else if( input[0] == 'r' || input[0] == 'R' ) {
-				life = 1;
-				continue;
+			if( inputlen <= 0 ) {
+				goto done;
 			}
-		}
-		else if( inputlen == 3 ) {
-			if( input[0] == 0x1B && (input[1] == 0x5B || input[1] == 0x4F) ) {
-				if( input[2] == DIRUP ) { //Arrow Up
-					offset = offset - buffer_width/8;
-				}
-				else if( input[2] == DIRDN ) { //Arrow Down
-					offset = offset + buffer_width/8;
-				}
-				else if( input[2] == DIRRT ) { //Arrow Right
-					col_offset++;
+			for( pos=0; pos<inputlen; pos+=len ) {
+				len = key_length(input+pos,inputlen-pos);
+				action = run_key(input+pos,len);
+				if( action == KEY_QUIT ) {
+					goto done;
 				}
-				else if( input[2] == DIRLT ) { //Arrow Left
-					col_offset--;
+				if( action == KEY_UPDATE ) {
+					redraw = 1;
 				}
-				else if( input[2] == 0x46 ) { //End
-					offset = fd_size;
-				}
-				else if( input[2] == 0x48 ) { //Home
-					offset = 0;
+				if( action == KEY_REDRAW ) {
+					redraw = 1;
 				}
 			}
 		}
-		else if( inputlen == 4 ) {
-			if( input[0] == 0x1B && input[1] == 0x5B && input[3] == 0x7E ) {
-				if( input[2] == 0x35 ) { //Page Up
-					offset = offset - buffer_size;
-				}
-				else if( input[2] == 0x36 ) { //Page Down
-					offset = offset + buffer_size;
-				}
+		//Seeding was stopped by a key, which is read by now or next time
+		//round, so Life isn't running
+		if( life_seed_stopped && life ) {
+			life = 0;
+			redraw = 1;
+		}
+		
+		if( step && wolfram_ring ) {
+			wolfram_step(glyph_h);
+			redraw = 1;
+		}
+		if( life_rate < 0 && step && life ) {
+			step_life();
+			redraw = 1;
+		}
+		//A frame shows whichever generation the Life thread is up to
+		if( life_rate >= 0 ) {
+			if( step && life_generation != shown ) {
+				redraw = 1;
+			}
+			if( (life && !life_period) != life_running ) {
+				life_thread_run(life && !life_period);
 			}
 		}
-		if( life ) {
-			life = 0;
-			free(life_buffer);
-			life_buffer = 0;
-			buffer_offset = -1;
+		if( redraw ) {
+			update();
+			shown = life_generation;
+		}
+		//Life stops by itself once it repeats
+		if( ((life && !life_period) || wolfram_ring) != ticking ) {
+			ticking = !ticking;
+			life_timer(tfd,ticking);
 		}
-		update();
+		pthread_mutex_unlock(&life_lock);
 	}
 	
+done:
 	term_reset();
 }
 
@@ -462,28 +4664,41 @@ void stream_sigint_handler(int signalId) {
 	exit(0);
 }
 
+void stream_sigwinch_handler(int signalId) {
+	(void)signalId;
+	term_resized = 1;
+}
+
 static void stream() {
 	int term_w, term_h;
 	int char_x, disp_w;
+	int i;
+	const uint8_t* rows[4];
+	size_t lens[4];
+	uint8_t* indices = 0;
 	uint8_t* tmp;
-	uint8_t index;
 	ssize_t readlen;
 	size_t buffer_offset;
 	struct sigaction action;
 	
 	action.sa_handler = stream_sigint_handler;
 	sigaction(SIGINT, &action, 0);
+	//The next line is laid out for the new size; reads carry on
+	memset(&action,0,sizeof(action));
+	action.sa_handler = stream_sigwinch_handler;
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGWINCH, &action, 0);
 	
 	for(;;) {
 		term_size(&term_w,&term_h);
 		if( !buffer_width ) {
-			buffer_width = term_w*2;
+			buffer_width = term_w*glyph_w;
 		}
 		if( buffer_width % 8 ) {
 			buffer_width = buffer_width - (buffer_width % 8);
 		}
 		
-		buffer_size = buffer_width/8*3;
+		buffer_size = buffer_width/8*glyph_h;
 		tmp = realloc(buffer,buffer_size);
 		if( !tmp ) {
 			free(buffer);
@@ -500,26 +4715,75 @@ static void stream() {
 			}
 			buffer_offset = buffer_offset + readlen;
 		}
-		disp_w = buffer_width/2;
+		disp_w = buffer_width/glyph_w;
+		for( i=0; i<glyph_h; i++ ) {
+			rows[i] = buffer + i*(buffer_width/8);
+			lens[i] = buffer_width/8;
+		}
+		tmp = realloc(indices,disp_w);
+		if( !tmp ) {
+			free(indices);
+			fprintf(stderr,"Memory allocation error: %s\n",strerror(errno));
+			exit(-1);
+		}
+		indices = tmp;
+		glyph_row(indices,rows,lens,0,disp_w);
+		out_reserve(disp_w*4+1);
 		for( char_x=0; char_x<disp_w; char_x++ ) {
-			index = 0;
-			index = (index<<1) | getbit(buffer,2*char_x  ,0);
-			index = (index<<1) | getbit(buffer,2*char_x+1,0);
-			index = (index<<1) | getbit(buffer,2*char_x  ,1);
-			index = (index<<1) | getbit(buffer,2*char_x+1,1);
-			index = (index<<1) | getbit(buffer,2*char_x  ,2);
-			index = (index<<1) | getbit(buffer,2*char_x+1,2);
-			printf("%s",utf8_encode(0,sextant_chars[index]));
-		}
-		printf("\n");
-		fflush(stdout);
+			out_glyph(indices[char_x]);
+		}
+		out_buffer[out_len++] = '\n';
+		out_flush();
 		
 		usleep(delay_ms*1000);
 	}
 }
 
+//Read a Life-like rule into life_birth and life_survive: B3/S23 style
+//(either order, any case, "/" optional) or the older S/B form, 23/3.
+//Returns 0 if it isn't one, or has no digits at all, which would only
+//kill everything.
+static int parse_rule(const char* rule) {
+	uint32_t birth = 0;
+	uint32_t survive = 0;
+	uint32_t* set = 0;
+	int letters = 0;
+	
+	for( ; *rule; rule++ ) {
+		if( *rule == 'B' || *rule == 'b' ) {
+			set = &birth;
+			letters = 1;
+		}
+		else if( *rule == 'S' || *rule == 's' ) {
+			set = &survive;
+			letters = 1;
+		}
+		else if( *rule == '/' ) {
+			set = letters ? 0 : &birth;
+		}
+		else if( *rule >= '0' && *rule <= '8' ) {
+			if( !set ) {
+				if( letters ) {
+					return 0;
+				}
+				set = &survive;
+			}
+			*set |= 1 << (*rule - '0');
+		}
+		else {
+			return 0;
+		}
+	}
+	if( !birth && !survive ) {
+		return 0;
+	}
+	life_birth = birth;
+	life_survive = survive;
+	return 1;
+}
+
 int main(int argc, char** argv) {
-	int i;
+	int i, g;
 	
 	i = 1;
 	while( i < argc ) {
@@ -553,6 +4817,27 @@ int main(int argc, char** argv) {
 				usage(argv[0]);
 			}
 		}
+		else if( !strncmp(argv[i],"-R",2) ) {
+			if( !parse_rule(argv[i]+2) ) {
+				fprintf(stderr,"Rule error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
+		else if( !strncmp(argv[i],"-T",2) ) {
+			if( !strcmp(argv[i]+2,"plane") ) {
+				life_topology = LIFE_PLANE;
+			}
+			else if( !strcmp(argv[i]+2,"torus") ) {
+				life_topology = LIFE_TORUS;
+			}
+			else if( !strcmp(argv[i]+2,"klein") ) {
+				life_topology = LIFE_KLEIN;
+			}
+			else {
+				fprintf(stderr,"Topology error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
 		else if( !strncmp(argv[i],"-d",2) ) {
 			errno = 0;
 			delay_ms = strtoul(argv[i]+2,0,0);
@@ -561,6 +4846,50 @@ int main(int argc, char** argv) {
 				usage(argv[0]);
 			}
 		}
+		else if( !strncmp(argv[i],"-E",2) ) {
+			errno = 0;
+			wolfram_rule = strtoul(argv[i]+2,0,0);
+			if( errno || wolfram_rule < 0 || wolfram_rule > 255 ) {
+				fprintf(stderr,"Rule error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
+		else if( !strncmp(argv[i],"-g",2) ) {
+			glyph_mode = -1;
+			for( g=0; g<=GLYPH_HALF; g++ ) {
+				if( !strcmp(argv[i]+2,glyph_names[g]) ) {
+					glyph_mode = g;
+				}
+			}
+			if( glyph_mode < 0 ) {
+				fprintf(stderr,"Glyph error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
+		else if( !strncmp(argv[i],"-P",2) ) {
+			errno = 0;
+			zoom_threshold = strtoul(argv[i]+2,0,0);
+			if( errno || zoom_threshold < 1 || zoom_threshold > 100 ) {
+				fprintf(stderr,"Density error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
+		else if( !strncmp(argv[i],"-G",2) ) {
+			errno = 0;
+			life_rate = strtoul(argv[i]+2,0,0);
+			if( errno || life_rate < 0 || life_rate > 1000000000 ) {
+				fprintf(stderr,"Generation rate error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
+		else if( !strncmp(argv[i],"-F",2) ) {
+			errno = 0;
+			frame_rate = strtoul(argv[i]+2,0,0);
+			if( errno || frame_rate < 1 || frame_rate > 1000 ) {
+				fprintf(stderr,"Frame rate error: %s\n\n",argv[i]+2);
+				usage(argv[0]);
+			}
+		}
 		else if( fd < 0 ) {
 			errno = 0;
 			fd = open(argv[i],O_RDONLY);
@@ -580,6 +4909,8 @@ int main(int argc, char** argv) {
 		i++;
 	}
 	
+	simd_setup();
+	glyph_setup();
 	if( fd < 0 ) {
 		stream();
 	}